@@ -1,9 +1,19 @@
 #pragma once
 #include <Arduino.h>
 #include "Appliance/ApplianceBase.h"
+#include "Appliance/Subscription.h"
 #include "Appliance/AirConditioner/Capabilities.h"
+#include "Appliance/AirConditioner/PropertyData.h"
 #include "Appliance/AirConditioner/StatusData.h"
+#include "Appliance/AirConditioner/StateHistory.h"
 #include "Helpers/Helpers.h"
+#include "Helpers/MpscQueue.h"
+#include "Helpers/EnergyMeter.h"
+#include "Helpers/Seqlock.h"
+
+#ifndef MIDEA_COMMAND_QUEUE_SIZE
+#define MIDEA_COMMAND_QUEUE_SIZE 8
+#endif
 
 namespace dudanov {
 namespace midea {
@@ -18,35 +28,159 @@ struct Control {
   Optional<SwingMode> swingMode{};
 };
 
+/// Trivially copyable snapshot of appliance state
+struct State {
+  float targetTemp;
+  float indoorTemp;
+  float outdoorTemp;
+  float indoorHumidity;
+  float powerUsage;
+  /// Time of last status update, ms
+  uint32_t time;
+  Mode mode;
+  Preset preset;
+  FanMode fanMode;
+  SwingMode swingMode;
+};
+
+/// State fields for subscriptions
+enum StateField : uint16_t {
+  FIELD_MODE = 1 << 0,
+  FIELD_PRESET = 1 << 1,
+  FIELD_FAN_MODE = 1 << 2,
+  FIELD_SWING_MODE = 1 << 3,
+  FIELD_TARGET_TEMP = 1 << 4,
+  FIELD_INDOOR_TEMP = 1 << 5,
+  FIELD_OUTDOOR_TEMP = 1 << 6,
+  FIELD_INDOOR_HUM = 1 << 7,
+  FIELD_POWER_USAGE = 1 << 8,
+  FIELD_ALL = (1 << 9) - 1,
+};
+
+/// Optional periodic queries
+enum PollQuery : uint8_t {
+  /// Power usage (0xC1). Requires `Capabilities::powerCal()`.
+  POLL_POWER_USAGE,
+  /// Indoor humidity property (0xB1). Requires `Capabilities::indoorHumidity()`.
+  POLL_INDOOR_HUMIDITY,
+  NUM_POLL_QUERIES,
+};
+
+/// Callback with successfully read property
+using PropertyCallback = std::function<void(uint16_t id, const uint8_t *data, uint8_t size)>;
+
+enum CommandType : uint8_t {
+  COMMAND_CONTROL,
+  COMMAND_POWER,
+  COMMAND_DISPLAY_TOGGLE,
+};
+
+// Command posted from other threads
+struct Command {
+  Control control;
+  CommandType type;
+  bool state;
+};
+
 class AirConditioner : public ApplianceBase {
  public:
   AirConditioner() : ApplianceBase(AIR_CONDITIONER) {}
   void m_setup() override;
+  void m_loop() override;
+  TimerTick m_getNextDelay(TimerTick now) const override;
   void m_onIdle() override { this->m_getStatus(); }
-  void control(const Control &control);
-  void setPowerState(bool state);
+  Completion control(const Control &control);
+  Completion setPowerState(bool state);
   bool getPowerState() const { return this->m_mode != Mode::MODE_OFF; }
-  void togglePowerState() { this->setPowerState(this->m_mode == Mode::MODE_OFF); }
+  Completion togglePowerState() { return this->setPowerState(this->m_mode == Mode::MODE_OFF); }
+  /// Request status update out of regular polling
+  Completion requestStatus() { return this->m_getStatus(); }
+  /// Request power usage update out of regular polling
+  Completion requestPowerUsage() { return this->m_getPowerUsage(); }
+  /// Set period of optional query, ms. Zero disables query. Query is polled only if capabilities report
+  /// supports it. Without report only power usage is polled.
+  void setPollInterval(PollQuery query, uint32_t interval);
+  uint32_t getPollInterval(PollQuery query) const { return this->m_pollIntervals[query]; }
+  /// Query is polled by current plan
+  bool isPolled(PollQuery query) const { return this->m_pollTimers[query].isEnabled(); }
   float getTargetTemp() const { return this->m_targetTemp; }
   float getIndoorTemp() const { return this->m_indoorTemp; }
   float getOutdoorTemp() const { return this->m_outdoorTemp; }
   float getIndoorHum() const { return this->m_indoorHumidity; }
   float getPowerUsage() const { return this->m_powerUsage; }
+  /// Energy accounting from power usage counter readings
+  const EnergyMeter &getEnergyMeter() const { return this->m_energyMeter; }
+  /// History of temperatures, mode and power usage
+  const StateHistory &getHistory() const { return this->m_history; }
   Mode getMode() const { return this->m_mode; }
   SwingMode getSwingMode() const { return this->m_swingMode; }
   FanMode getFanMode() const { return this->m_fanMode; }
   Preset getPreset() const { return this->m_preset; }
   const Capabilities &getCapabilities() const { return this->m_capabilities; }
-  void displayToggle() { this->m_displayToggle(); }
+  Completion displayToggle() { return this->m_displayToggle(); }
+  /// Query many properties in one 0xB1 request. Known properties update state,
+  /// all successfully read properties are passed to property callback.
+  Completion queryProperties(const uint16_t *ids, uint8_t num);
+  Completion queryProperties(std::initializer_list<uint16_t> ids) { return this->queryProperties(ids.begin(), ids.size()); }
+  /// Set many properties in one 0xB0 request. `data` must not have CRC appended.
+  Completion setProperties(PropertySetData data);
+  void setOnPropertyCallback(PropertyCallback cb) { this->m_propertyCallback = std::move(cb); }
+  /// Consistent state snapshot. May be called from any thread.
+  State getState() const { return this->m_state.load(); }
+  /// Number of published state snapshots. May be called from any thread.
+  uint32_t getStateVersion() const { return this->m_state.getVersion(); }
+  /// Add listener of state fields changes. Temperature deadbands are in °C, power usage in kWh.
+  void subscribe(const SubscriptionOptions &options, OnChangeCallback cb) { this->m_subscriptions.add(options, std::move(cb)); }
+
+  /* THREAD-SAFE COMMANDS. Executed in loop(). Return `false` if command queue is full. */
+
+  bool postControl(const Control &control) { return this->m_commands.push(Command{control, COMMAND_CONTROL, false}); }
+  bool postPowerState(bool state) { return this->m_commands.push(Command{Control{}, COMMAND_POWER, state}); }
+  bool postDisplayToggle() { return this->m_commands.push(Command{Control{}, COMMAND_DISPLAY_TOGGLE, false}); }
  protected:
-  void m_getPowerUsage();
+  void m_processCommands() override;
+  Completion m_getPowerUsage();
+  Completion m_getIndoorHumidity();
+  Completion m_queryProperties(RequestClass cls, PropertyQueryData data, uint32_t lifetime);
+  // Appliance supports query or its capabilities are unknown and query is polled by default
+  bool m_isSupported(PollQuery query) const;
+  // Start or stop poll timers according to intervals and capabilities
+  void m_updatePollPlan();
   void m_getCapabilities();
-  void m_getStatus();
-  void m_setStatus(StatusData status);
-  void m_displayToggle();
+  // Request page of capabilities report
+  void m_requestCapabilities(RequestClass cls, FrameData data);
+  Completion m_getStatus();
+  Completion m_setStatus(Transaction transaction);
+  Completion m_displayToggle();
   ResponseStatus m_readStatus(FrameData data);
+  ResponseStatus m_readProperties(FrameData data);
+  // Publish state snapshot for other threads
+  void m_publishState();
+  // State is updated: notify listeners
+  void m_onStateChanged() {
+    this->m_isStateChanged = true;
+    this->sendUpdate();
+  }
+  void m_recordHistory() {
+    this->m_history.record(this->m_indoorTemp, this->m_outdoorTemp, this->m_targetTemp, this->m_energyMeter.getCounter(),
+                           this->m_mode, this->m_timerManager.getTime());
+  }
   Capabilities m_capabilities{};
-  Timer m_powerUsageTimer;
+  // Maximum number of capabilities report pages
+  static const uint8_t MAX_CAPABILITIES_PAGES = 8;
+  // Index of last requested capabilities page
+  uint8_t m_capabilitiesPage{};
+  // Last capabilities page requires next one
+  bool m_hasMoreCapabilities{};
+  // Optional queries timers
+  Timer m_pollTimers[NUM_POLL_QUERIES];
+  // Optional queries intervals, ms. Also lifetime of queued query: next one is queued after this period.
+  uint32_t m_pollIntervals[NUM_POLL_QUERIES]{30 * 1000, 60 * 1000};
+  // Poll timers are registered
+  bool m_isPollPlanActive{};
+  // Power usage counter has 0.1 kWh resolution and 6 BCD digits
+  EnergyMeter m_energyMeter{100, 1000000};
+  StateHistory m_history{};
   float m_indoorHumidity{};
   float m_indoorTemp{};
   float m_outdoorTemp{};
@@ -58,6 +192,19 @@ class AirConditioner : public ApplianceBase {
   SwingMode m_swingMode{SwingMode::SWING_OFF};
   Preset m_lastPreset{Preset::PRESET_NONE};
   StatusData m_status{};
+  SubscriptionList m_subscriptions;
+  PropertyCallback m_propertyCallback;
+  // Indoor humidity is read by property query
+  bool m_hasHumidityProperty{};
+  // State snapshot for other threads
+  Seqlock<State> m_state;
+  // Subscriptions must be checked
+  bool m_isStateChanged{};
+  // Commands posted from other threads
+  MpscQueue<Command, MIDEA_COMMAND_QUEUE_SIZE> m_commands;
+  // Command taken from queue and waiting for previous control completion
+  Command m_command{};
+  bool m_hasCommand{};
   bool m_sendControl{};
 };
 
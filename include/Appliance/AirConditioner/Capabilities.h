@@ -11,7 +11,9 @@ namespace ac {
 
 class Capabilities {
  public:
-  // Read from frames
+  // Start reading of new report
+  void begin() { this->m_recordSize = 0; }
+  // Read report page. Records may continue in next page. Returns `true` if next page must be requested.
   bool read(const FrameData &data);
   // Dump capabilities
   void dump() const;
@@ -72,6 +74,13 @@ class Capabilities {
   bool supportLightControl() const { return this->m_lightControl; }
 
  protected:
+  // Read bytes of record. Returns `true` if record is complete and applied.
+  bool m_parseRecord(const uint8_t *&it, const uint8_t *end);
+  void m_apply(uint16_t id, const uint8_t *data, uint8_t size);
+  // Record being read: id_lo, id_hi, size, data
+  uint8_t m_record[32];
+  // Number of read bytes of record
+  uint16_t m_recordSize{};
   bool m_updownFan{false};
   bool m_leftrightFan{false};
   bool m_autoMode{false};
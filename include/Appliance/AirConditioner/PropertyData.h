@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include "Frame/FrameData.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// Property IDs of 0xB0/0xB1 property protocol
+enum PropertyID : uint16_t {
+  PROPERTY_SWING_UD_ANGLE = 0x0009,
+  PROPERTY_SWING_LR_ANGLE = 0x000A,
+  PROPERTY_INDOOR_HUMIDITY = 0x0015,
+  PROPERTY_SILKY_COOL = 0x0018,
+  PROPERTY_SMART_EYE = 0x0030,
+  PROPERTY_WIND_ON_ME = 0x0032,
+  PROPERTY_WIND_OF_ME = 0x0033,
+  PROPERTY_ACTIVE_CLEAN = 0x0039,
+  PROPERTY_ONE_KEY_NO_WIND_ON_ME = 0x0042,
+  PROPERTY_BREEZE_CONTROL = 0x0043,
+  PROPERTY_BUZZER = 0x022C,
+};
+
+/// Query of many properties in one 0xB1 frame: [0xB1, count, id_lo, id_hi, ...]
+class PropertyQueryData : public FrameData {
+ public:
+  static const uint8_t MAX_PROPERTIES = 64;
+  /// Only first `MAX_PROPERTIES` IDs are queried
+  PropertyQueryData(const uint16_t *ids, uint8_t num);
+  PropertyQueryData(std::initializer_list<uint16_t> ids) : PropertyQueryData(ids.begin(), ids.size()) {}
+};
+
+/// Setting of many properties in one 0xB0 frame: [0xB0, count, id_lo, id_hi, size, data..., ...].
+/// CRC is appended by `AirConditioner::setProperties()`.
+class PropertySetData : public FrameData {
+ public:
+  PropertySetData() : FrameData({0xB0, 0x00}) {}
+  /// Returns `false` if frame has no room for property
+  bool add(uint16_t id, const uint8_t *data, uint8_t size);
+  bool add(uint16_t id, uint8_t value) { return this->add(id, &value, 1); }
+};
+
+/// Single pass reader of 0xB0/0xB1 response records: [id_lo, id_hi, result, size, data...]
+class PropertyReader {
+ public:
+  PropertyReader(const FrameData &data);
+  /// Advance to next record. Returns `false` at end of data or on malformed record.
+  bool next();
+  uint16_t id() const { return this->m_it[0] | (this->m_it[1] << 8); }
+  /// Result code. Zero means success.
+  uint8_t result() const { return this->m_it[2]; }
+  bool isSuccess() const { return !this->result(); }
+  uint8_t size() const { return this->m_it[3]; }
+  const uint8_t *data() const { return this->m_it + 4; }
+
+ protected:
+  // Current record
+  const uint8_t *m_it{nullptr};
+  // Next record
+  const uint8_t *m_next;
+  // End of records
+  const uint8_t *m_end;
+  // Remaining records
+  uint8_t m_num;
+};
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
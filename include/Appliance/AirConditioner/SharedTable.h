@@ -0,0 +1,85 @@
+#pragma once
+#ifdef __linux__
+#include "Appliance/AirConditioner/AirConditioner.h"
+#include "Helpers/Seqlock.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// Appliance record in shared state table
+struct SharedRecord {
+  char name[24];
+  State state;
+  Statistics stats;
+  Availability availability;
+  AutoconfStatus autoconf;
+  /// Record contains data
+  bool used;
+};
+
+/// Header of shared state table
+struct SharedHeader {
+  static const uint32_t MAGIC = 0x4145444D;  // "MDEA"
+  static const uint16_t VERSION = 1;
+  uint32_t magic;
+  uint16_t version;
+  uint16_t numSlots;
+  uint32_t slotSize;
+  uint32_t reserved;
+};
+
+using SharedSlot = Seqlock<SharedRecord>;
+
+/// Exports appliance states into named POSIX shared memory table of fixed-size versioned slots.
+/// Readers in other processes get consistent snapshots without syscalls. Needs `-lrt` on glibc older than 2.34.
+class SharedTableWriter {
+ public:
+  ~SharedTableWriter() { this->close(); }
+  /// Create table with `numSlots` slots. `name` is shared memory object name like "/midea".
+  /// Existing table is marked stale and unlinked, never resized in place: readers keep their mapping valid.
+  bool open(const char *name, uint16_t numSlots);
+  /// Unmap table. Shared memory object is kept for readers.
+  void close();
+  /// Mark table stale and remove shared memory object
+  static bool unlink(const char *name);
+  /// Publish appliance state and statistics to slot
+  bool publish(uint16_t slot, const AirConditioner &appliance, const char *name = "");
+  /// Mark slot as unused
+  bool clear(uint16_t slot);
+  bool isOpen() const { return this->m_header != nullptr; }
+
+ protected:
+  SharedHeader *m_header{nullptr};
+  SharedSlot *m_slots{nullptr};
+  size_t m_size{};
+};
+
+/// Maps shared state table for reading
+class SharedTableReader {
+ public:
+  ~SharedTableReader() { this->close(); }
+  /// Map existing table. Fails on wrong layout version.
+  bool open(const char *name);
+  void close();
+  /// Number of slots at the time of mapping
+  uint16_t getNumSlots() const { return this->m_numSlots; }
+  /// Table was replaced or removed by writer. Reopen to follow new table.
+  bool isStale() const;
+  /// Consistent copy of slot record. Returns `false` if slot is out of range or unused.
+  bool read(uint16_t slot, SharedRecord &record) const;
+  /// Number of updates of slot
+  uint32_t getVersion(uint16_t slot) const { return slot < this->m_numSlots ? this->m_slots[slot].getVersion() : 0; }
+
+ protected:
+  const SharedHeader *m_header{nullptr};
+  const SharedSlot *m_slots{nullptr};
+  size_t m_size{};
+  // Number of slots validated against mapped size
+  uint16_t m_numSlots{};
+};
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+#include "Appliance/AirConditioner/AirConditioner.h"
+#include "Helpers/Encoder.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// Encode state fields selected by `StateField` mask as map. Returns required buffer size.
+size_t encodeState(Encoder &encoder, const State &state, uint16_t fields = FIELD_ALL);
+/// Encode capabilities report as map. Returns required buffer size.
+size_t encodeCapabilities(Encoder &encoder, const Capabilities &capabilities);
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,152 @@
+#pragma once
+#include <Arduino.h>
+#include <iterator>
+#include "Appliance/AirConditioner/StatusData.h"
+
+#ifndef MIDEA_HISTORY_RAW_SIZE
+#define MIDEA_HISTORY_RAW_SIZE 64
+#endif
+
+#ifndef MIDEA_HISTORY_MINUTE_SIZE
+#define MIDEA_HISTORY_MINUTE_SIZE 60
+#endif
+
+#ifndef MIDEA_HISTORY_HOUR_SIZE
+#define MIDEA_HISTORY_HOUR_SIZE 48
+#endif
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+/// History sample. Temperatures in 0.1 °C, power usage in 0.1 kWh.
+struct HistorySample {
+  /// Seconds since history start
+  uint32_t time;
+  int16_t indoorTemp;
+  int16_t outdoorTemp;
+  int16_t targetTemp;
+  uint32_t powerUsage;
+  Mode mode;
+  float getIndoorTemp() const { return static_cast<float>(this->indoorTemp) * 0.1F; }
+  float getOutdoorTemp() const { return static_cast<float>(this->outdoorTemp) * 0.1F; }
+  float getTargetTemp() const { return static_cast<float>(this->targetTemp) * 0.1F; }
+  float getPowerUsage() const { return static_cast<float>(this->powerUsage) * 0.1F; }
+  /// Equality of values ignoring time
+  bool isSameState(const HistorySample &other) const;
+};
+
+/// Packed difference between two consecutive samples
+struct HistoryRecord {
+  uint16_t dt;
+  int16_t indoorTemp;
+  int16_t outdoorTemp;
+  int16_t targetTemp;
+  int16_t powerUsage;
+  // Bits 0-6: mode. Bit 7: partial record, next record belongs to the same sample.
+  uint8_t mode;
+} __attribute__((packed));
+
+/// Fixed-size history buffer. Keeps first sample and deltas to following samples.
+/// When full, oldest delta is merged into the first sample.
+class HistoryBuffer {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = HistorySample;
+    using difference_type = ptrdiff_t;
+    using pointer = const HistorySample *;
+    using reference = const HistorySample &;
+    Iterator(const HistoryBuffer *buffer, uint16_t idx);
+    const HistorySample &operator*() const { return this->m_sample; }
+    const HistorySample *operator->() const { return &this->m_sample; }
+    Iterator &operator++();
+    bool operator==(const Iterator &other) const { return this->m_idx == other.m_idx; }
+    bool operator!=(const Iterator &other) const { return this->m_idx != other.m_idx; }
+   private:
+    // Apply records while sample is partial
+    void m_skipPartial(bool partial);
+    const HistoryBuffer *m_buffer;
+    HistorySample m_sample;
+    // Index of next record to apply. `UINT16_MAX` at end.
+    uint16_t m_idx;
+  };
+  Iterator begin() const { return Iterator(this, this->m_hasBase ? 0 : UINT16_MAX); }
+  Iterator end() const { return Iterator(this, UINT16_MAX); }
+  bool empty() const { return !this->m_hasBase; }
+  /// Newest sample. Buffer must not be empty.
+  const HistorySample &last() const { return this->m_last; }
+  /// Copy samples with time in range [from, to] to `out`. Returns number of copied samples.
+  size_t query(uint32_t from, uint32_t to, HistorySample *out, size_t size) const;
+  /// Clear buffer
+  void clear() {
+    this->m_count = this->m_head = 0;
+    this->m_hasBase = false;
+  }
+  /// Append sample. Time must not decrease.
+  void push(const HistorySample &sample);
+
+ protected:
+  HistoryBuffer(HistoryRecord *records, uint16_t capacity) : m_records(records), m_capacity(capacity) {}
+  HistoryBuffer(const HistoryBuffer &) = delete;
+  HistoryBuffer &operator=(const HistoryBuffer &) = delete;
+  const HistoryRecord &m_record(uint16_t idx) const { return this->m_records[(this->m_head + idx) % this->m_capacity]; }
+  void m_append(const HistoryRecord &record);
+  static void m_apply(HistorySample &sample, const HistoryRecord &record);
+  HistoryRecord *m_records;
+  // First retained sample
+  HistorySample m_base{};
+  // Newest sample
+  HistorySample m_last{};
+  uint16_t m_capacity;
+  uint16_t m_head{};
+  uint16_t m_count{};
+  bool m_hasBase{};
+  // First sample is partial
+  bool m_basePartial{};
+};
+
+template<uint16_t N> class HistoryRing : public HistoryBuffer {
+ public:
+  HistoryRing() : HistoryBuffer(m_storage, N) {}
+ protected:
+  HistoryRecord m_storage[N];
+};
+
+enum HistoryTier : uint8_t {
+  /// Every change
+  HISTORY_RAW,
+  /// Last state of every minute with change
+  HISTORY_MINUTE,
+  /// Last state of every hour with change
+  HISTORY_HOUR,
+};
+
+/// Fixed-memory state history with downsampling tiers
+class StateHistory {
+ public:
+  /// Add current state at `ms` time. Unchanged state is not recorded.
+  void record(float indoorTemp, float outdoorTemp, float targetTemp, uint32_t powerUsage, Mode mode, uint32_t ms);
+  const HistoryBuffer &get(HistoryTier tier) const;
+  /// Copy samples of tier with time in range [from, to] to `out`. Returns number of copied samples.
+  size_t query(HistoryTier tier, uint32_t from, uint32_t to, HistorySample *out, size_t size) const {
+    return this->get(tier).query(from, to, out, size);
+  }
+  /// Current history time, seconds
+  uint32_t getTime() const { return this->m_seconds; }
+
+ protected:
+  HistoryRing<MIDEA_HISTORY_RAW_SIZE> m_raw;
+  HistoryRing<MIDEA_HISTORY_MINUTE_SIZE> m_minute;
+  HistoryRing<MIDEA_HISTORY_HOUR_SIZE> m_hour;
+  HistorySample m_current{};
+  uint32_t m_ms{};
+  uint32_t m_msRemainder{};
+  uint32_t m_seconds{};
+  bool m_hasCurrent{};
+};
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
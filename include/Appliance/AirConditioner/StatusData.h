@@ -105,7 +105,9 @@ class StatusData : public FrameData {
   void setPreset(Preset preset);
 
   /* POWER USAGE */
-  float getPowerUsage() const;
+  float getPowerUsage() const { return static_cast<float>(this->getRawPowerUsage()) * 0.1F; }
+  /// Power usage counter in 0.1 kWh units
+  uint32_t getRawPowerUsage() const;
 
   void setBeeper(bool state) {
     this->m_setMask(1, true, 2);
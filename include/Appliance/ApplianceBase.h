@@ -1,10 +1,37 @@
 #pragma once
-#include <deque>
 #include <Arduino.h>
+#include <atomic>
+#include <memory>
 #include "Frame/Frame.h"
 #include "Frame/FrameData.h"
+#include "Frame/FrameTrace.h"
+#include "Appliance/Completion.h"
+#include "Appliance/NetworkStatus.h"
 #include "Helpers/Timer.h"
+#include "Helpers/DurationStats.h"
 #include "Helpers/Logger.h"
+#include "Helpers/RttEstimator.h"
+#include "Helpers/Scheduler.h"
+#include "Helpers/SpscRing.h"
+#ifdef ARDUINO_ARCH_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+#ifndef MIDEA_QUEUE_CAPACITY
+#define MIDEA_QUEUE_CAPACITY 16
+#endif
+
+#ifndef MIDEA_RX_RING_SIZE
+#define MIDEA_RX_RING_SIZE 4
+#endif
+
+// Define MIDEA_PROFILING for loop phases profiling
+#ifdef MIDEA_PROFILING
+#define MIDEA_PROFILE(phase) const dudanov::ProfileScope profileScope_(this->m_profile[phase])
+#else
+#define MIDEA_PROFILE(phase)
+#endif
 
 namespace dudanov {
 namespace midea {
@@ -26,6 +53,15 @@ enum AutoconfStatus : uint8_t {
   AUTOCONF_ERROR,
 };
 
+enum Availability : uint8_t {
+  /// Appliance answers requests
+  AVAILABILITY_ONLINE,
+  /// Some requests failed
+  AVAILABILITY_DEGRADED,
+  /// Appliance doesn't answer. Only rare probe requests are sent.
+  AVAILABILITY_OFFLINE,
+};
+
 enum ResponseStatus : uint8_t {
   RESPONSE_OK,
   RESPONSE_PARTIAL,
@@ -40,13 +76,110 @@ enum FrameType : uint8_t {
   QUERY_NETWORK = 0x63,
 };
 
+/// Request scheduling classes in priority order
+enum RequestClass : uint8_t {
+  /// User control commands
+  CLASS_CONTROL,
+  /// Responses to requests from appliance
+  CLASS_RESPONSE,
+  /// Status queries
+  CLASS_QUERY,
+  /// Notifications without response
+  CLASS_NOTIFY,
+  /// Periodic background polling
+  CLASS_BACKGROUND,
+  NUM_REQUEST_CLASSES,
+};
+
+/// Action on request to full queue
+enum OverflowPolicy : uint8_t {
+  /// New request is rejected
+  OVERFLOW_REJECT,
+  /// Oldest request of the same class is dropped
+  OVERFLOW_DROP_OLDEST,
+  /// Queued request of the same kind (type and command bytes) is dropped, otherwise new request is rejected
+  OVERFLOW_REPLACE,
+};
+
+/// Communication statistics
+struct Statistics {
+  /// Transmitted frames
+  uint32_t txFrames;
+  /// Received valid frames
+  uint32_t rxFrames;
+  /// Successfully completed requests
+  uint32_t completed;
+  /// Requests failed after all attempts
+  uint32_t failed;
+  /// Repeated transmissions after response timeout
+  uint32_t retries;
+  /// Requests dropped from queue after deadline
+  uint32_t expired;
+  /// Frames dropped by receive thread because of full RX ring
+  uint32_t rxOverruns;
+  /// Partial or corrupted frames discarded by receiver
+  uint32_t rxDiscards;
+  /// Requests rejected by full queue
+  uint32_t rejected;
+  /// Queued requests dropped by full queue
+  uint32_t dropped;
+  /// Maximum number of queued requests
+  uint32_t queueHighWater;
+};
+
+/// Profiled phases of `loop()`. Phases may be nested: time of handler includes state callbacks
+/// and transmissions started by it, time of timers includes repeated transmissions.
+enum ProfilePhase : uint8_t {
+  /// Whole `loop()` call
+  PROFILE_LOOP,
+  /// Interval between starts of `loop()` calls
+  PROFILE_INTERVAL,
+  /// Timers task
+  PROFILE_TIMERS,
+  /// Reading and parsing of received bytes
+  PROFILE_RX,
+  /// Handling of received frame
+  PROFILE_HANDLER,
+  /// State callbacks and subscriptions
+  PROFILE_CALLBACKS,
+  /// Frame transmission
+  PROFILE_TX,
+  NUM_PROFILE_PHASES,
+};
+
 using Handler = std::function<void()>;
 using ResponseHandler = std::function<ResponseStatus(FrameData)>;
 using OnStateCallback = std::function<void()>;
+using OnAvailabilityCallback = std::function<void(Availability)>;
+
+/// Ordered sequence of frames queued and completed as one unit.
+/// Frames are sent one by one, each after successful response to previous one.
+/// Failure of any frame aborts whole transaction.
+class Transaction {
+ public:
+  /// Append frame to transaction
+  Transaction &add(FrameType type, FrameData data, ResponseHandler onData = nullptr) {
+    this->m_steps.push_back(Step{std::move(data), std::move(onData), type});
+    return *this;
+  }
+  bool empty() const { return this->m_steps.empty(); }
+  size_t size() const { return this->m_steps.size(); }
+
+ protected:
+  friend class ApplianceBase;
+  struct Step {
+    FrameData data;
+    ResponseHandler onData;
+    FrameType type;
+  };
+  std::vector<Step> m_steps;
+};
 
 class ApplianceBase {
  public:
   ApplianceBase(ApplianceType type) : m_appType(type) {}
+  /// Pending operations are completed as `COMPLETION_DROPPED`. Their `onError` handlers are not called.
+  virtual ~ApplianceBase();
   /// Setup
   void setup();
   /// Loop
@@ -62,39 +195,150 @@ class ApplianceBase {
   void setPeriod(uint32_t period) { this->m_period = period; }
   uint32_t getPeriod() const { return this->m_period; }
   /// Set waiting response timeout
-  void setTimeout(uint32_t timeout) { this->m_timeout = timeout; }
+  void setTimeout(uint32_t timeout) {
+    this->m_timeout = timeout;
+    this->m_rtt.setLimits(this->m_minTimeout, timeout);
+  }
   uint32_t getTimeout() const { return this->m_timeout; }
+  /// Estimate response timeout from measured round-trip times. Timeout set by `setTimeout()` is the ceiling.
+  void setAdaptiveTimeout(bool value) { this->m_adaptiveTimeout = value; }
+  bool getAdaptiveTimeout() const { return this->m_adaptiveTimeout; }
+  /// Set floor of adaptive response timeout
+  void setMinTimeout(uint32_t timeout) {
+    this->m_minTimeout = timeout;
+    this->m_rtt.setLimits(timeout, this->m_timeout);
+  }
+  uint32_t getMinTimeout() const { return this->m_minTimeout; }
+  /// Round-trip time estimator
+  const RttEstimator &getRttEstimator() const { return this->m_rtt; }
+  /// Write frames only as much as `availableForWrite()` allows and continue in next loops.
+  /// Stream must implement `availableForWrite()`.
+  void setNonBlockingWrite(bool value) { this->m_nonBlockingWrite = value; }
+  bool getNonBlockingWrite() const { return this->m_nonBlockingWrite; }
+  /// Enable inter-byte timeout derived from line baud rate
+  void setBaudRate(uint32_t baudRate);
+  /// Set maximum idle time inside frame, ms. Partial frame is discarded after it. Zero (default) disables timeout.
+  void setInterByteTimeout(uint32_t timeout) { this->m_receiver.setTimeout(timeout); }
+  uint32_t getInterByteTimeout() const { return this->m_receiver.getTimeout(); }
+  /// After corrupted data drop all bytes until line is idle for inter-byte timeout
+  void setIdleFraming(bool value) { this->m_receiver.setIdleFraming(value); }
   /// Set number of request attempts
   void setNumAttempts(uint8_t numAttempts) { this->m_numAttempts = numAttempts; }
   uint8_t getNumAttempts() const { return this->m_numAttempts; }
+  /// Set maximum waiting time of request class before it takes precedence over higher classes. Zero disables aging.
+  void setAgingLimit(RequestClass cls, uint32_t limit) { this->m_queue.setAgingLimit(cls, limit); }
+  uint32_t getAgingLimit(RequestClass cls) const { return this->m_queue.getAgingLimit(cls); }
+  /// Number of queued requests of class
+  size_t getQueueDepth(RequestClass cls) const { return this->m_queue.size(cls); }
+  /// Total number of queued requests
+  size_t getQueueDepth() const { return this->m_queue.size(); }
+  /// Set maximum number of queued requests. Zero means unbounded queue. Responses to appliance requests are never rejected.
+  void setQueueCapacity(size_t capacity) { this->m_queueCapacity = capacity; }
+  size_t getQueueCapacity() const { return this->m_queueCapacity; }
+  /// Set action on request to full queue
+  void setOverflowPolicy(OverflowPolicy policy) { this->m_overflowPolicy = policy; }
+  OverflowPolicy getOverflowPolicy() const { return this->m_overflowPolicy; }
+  /// Communication statistics
+  const Statistics &getStatistics() const { return this->m_stats; }
+  void resetStatistics() { this->m_stats = Statistics{}; }
   /// Set beeper feedback
   void setBeeper(bool value);
   /// Add listener for appliance state
   void addOnStateCallback(OnStateCallback cb) { this->m_stateCallbacks.push_back(cb); }
   void sendUpdate() {
+    MIDEA_PROFILE(PROFILE_CALLBACKS);
     for (auto &cb : this->m_stateCallbacks)
       cb();
   }
+  /// Add listener for availability changes
+  void addOnAvailabilityCallback(OnAvailabilityCallback cb) { this->m_availabilityCallbacks.push_back(cb); }
+  Availability getAvailability() const { return this->m_availability; }
+  bool isOnline() const { return this->m_availability != AVAILABILITY_OFFLINE; }
+  /// Set number of consecutive failed requests for going offline
+  void setOfflineThreshold(uint8_t value) { this->m_offlineThreshold = value; }
+  /// Set range of probe interval while offline. Interval is doubled after each failed probe
+  /// and reset by any data received from appliance.
+  void setProbeInterval(uint32_t minInterval, uint32_t maxInterval) {
+    this->m_minProbeInterval = minInterval;
+    this->m_maxProbeInterval = maxInterval;
+  }
   AutoconfStatus getAutoconfStatus() const { return this->m_autoconfStatus; }
   void setAutoconf(bool state) { this->m_autoconfStatus = state ? AUTOCONF_PROGRESS : AUTOCONF_DISABLED; }
   static void setLogger(LoggerFn logger) { dudanov::setLogger(logger); }
+  /// Set network status provider. `nullptr` reports disconnected network. Provider is read from `loop()`
+  /// once per network notification period, answers to QUERY_NETWORK use cached status.
+  void setNetworkStatusProvider(NetworkStatusProvider *provider) { this->m_networkProvider = provider; }
+  /// Set sink for binary trace of all RX and TX frames. `nullptr` disables tracing.
+  void setTraceSink(TraceSink *sink) { this->m_traceSink = sink; }
+#ifdef MIDEA_PROFILING
+  /// Duration statistics of loop phase, us
+  const DurationStats &getProfile(ProfilePhase phase) const { return this->m_profile[phase]; }
+  void resetProfile();
+  /// Log statistics of all phases
+  void dumpProfile() const;
+#endif
+
+  /* ############# */
+  /* ### CLOCK ### */
+  /* ############# */
+
+  /// Set clock source of timers. `nullptr` restores Arduino `millis()`.
+  /// Running timers, queued requests and probe backoff keep their remaining time.
+  void setClock(Clock *clock);
+  Clock &getClock() const { return this->m_timerManager.getClock(); }
+  /// Time of next scheduled work of `loop()`. Returns `false` if there is no scheduled work.
+  bool getNextDeadline(TimerTick &deadline) const;
+  /// Call `loop()` for `duration` ms or until `done` returns `true`. Returns result of `done`.
+  /// Virtual clock skips idle time between deadlines, so long scenarios run at full speed.
+  bool run(uint32_t duration, const std::function<bool()> &done = nullptr);
+
+  /* ######################### */
+  /* ### RECEIVE THREAD MODE ### */
+  /* ######################### */
+
+  /// Enable receiving in dedicated thread. In this mode `rxTask()` must be called periodically from
+  /// receive thread and `loop()` only handles complete frames. Must be called before `setup()`.
+  void setRxThreadMode(bool value);
+  bool getRxThreadMode() const { return this->m_rxRing != nullptr; }
+  /// Read stream and pass complete valid frames to `loop()`. Receive thread only.
+  void rxTask();
+#ifdef ARDUINO_ARCH_ESP32
+  /// Enable receive thread mode and start FreeRTOS task calling `rxTask()`
+  bool startRxTask(uint32_t stackSize = 2048, UBaseType_t priority = 5, BaseType_t core = tskNO_AFFINITY);
+#endif
 
  protected:
   std::vector<OnStateCallback> m_stateCallbacks;
   // Timer manager
   TimerManager m_timerManager{};
+#ifdef MIDEA_PROFILING
+  // Loop phases statistics
+  DurationStats m_profile[NUM_PROFILE_PHASES];
+#endif
   AutoconfStatus m_autoconfStatus{};
   // Beeper feedback flag
   bool m_beeper{};
 
-  void m_queueNotify(FrameType type, FrameData data) { this->m_queueRequest(type, std::move(data), nullptr); }
-  void m_queueRequest(FrameType type, FrameData data, ResponseHandler onData, Handler onSucess = nullptr, Handler onError = nullptr);
-  void m_queueRequestPriority(FrameType type, FrameData data, ResponseHandler onData = nullptr, Handler onSucess = nullptr, Handler onError = nullptr);
+  Completion m_queueNotify(FrameType type, FrameData data) { return this->m_queueRequest(CLASS_NOTIFY, type, std::move(data)); }
+  Completion m_queueRequest(FrameType type, FrameData data, ResponseHandler onData, Handler onSucess = nullptr, Handler onError = nullptr) {
+    return this->m_queueRequest(CLASS_QUERY, type, std::move(data), std::move(onData), std::move(onSucess), std::move(onError));
+  }
+  Completion m_queueRequestPriority(FrameType type, FrameData data, ResponseHandler onData = nullptr, Handler onSucess = nullptr, Handler onError = nullptr) {
+    return this->m_queueRequest(CLASS_CONTROL, type, std::move(data), std::move(onData), std::move(onSucess), std::move(onError));
+  }
+  /// Enqueue request. Request not sent within `lifetime` ms is dropped and `onError` is called. Zero lifetime means no deadline.
+  Completion m_queueRequest(RequestClass cls, FrameType type, FrameData data, ResponseHandler onData = nullptr, Handler onSucess = nullptr, Handler onError = nullptr, uint32_t lifetime = 0);
+  /// Enqueue transaction. `onSuccess` and `onError` are called once for whole transaction.
+  Completion m_queueTransaction(RequestClass cls, Transaction transaction, Handler onSuccess = nullptr, Handler onError = nullptr, uint32_t lifetime = 0);
   void m_sendFrame(FrameType type, const FrameData &data);
   // Setup for appliances
   virtual void m_setup() {}
   // Loop for appliances
   virtual void m_loop() {}
+  /// Calling at the top of loop for processing commands posted from other threads
+  virtual void m_processCommands() {}
+  // Time until next scheduled work of `loop()`. `TimerManager::NO_DEADLINE` if there is no scheduled work.
+  virtual TimerTick m_getNextDelay(TimerTick now) const;
   /// Calling then ready for request
   virtual void m_onIdle() {}
   /// Calling on receiving request
@@ -106,32 +350,115 @@ class ApplianceBase {
     Handler onSuccess;
     Handler onError;
     FrameType requestType;
+    Completion completion;
+    // Remaining transaction frames
+    std::vector<Transaction::Step> steps;
+    // Index of next transaction frame
+    uint8_t nextStep;
+    // Maximum time in queue, ms. Zero means no deadline.
+    uint32_t lifetime;
     ResponseStatus callHandler(const Frame &data);
+    // Load next transaction frame. Returns `false` if there is no more frames.
+    bool advance();
   };
   class FrameReceiver : public Frame {
   public:
-    bool read(Stream *stream);
+    bool read(Stream *stream, Clock &clock);
     void clear() { this->m_data.clear(); }
+    void assign(const uint8_t *data, uint8_t size) { this->m_data.assign(data, data + size); }
+    void setTimeout(uint32_t timeout) { this->m_timeout = timeout; }
+    uint32_t getTimeout() const { return this->m_timeout; }
+    void setIdleFraming(bool value) { this->m_idleFraming = value; }
+    uint32_t getNumDiscards() const { return this->m_numDiscards.load(std::memory_order_relaxed); }
+    // Time until end of inter-byte timeout. `TimerManager::NO_DEADLINE` if receiver doesn't wait for it.
+    TimerTick getNextDelay(TimerTick now) const;
+  private:
+    void m_discard();
+    // Time of last received byte
+    TimerTick m_lastByte{};
+    // Inter-byte timeout, ms. Zero disables timeout.
+    uint32_t m_timeout{};
+    // Discarded frames
+    std::atomic<uint32_t> m_numDiscards{0};
+    // Idle gap framing mode
+    bool m_idleFraming{};
+    // Dropping bytes until idle gap
+    bool m_isSyncLost{};
   };
+  struct FrameSlot {
+    uint8_t size;
+    uint8_t data[255];
+  };
+  using RxRing = SpscRing<FrameSlot, MIDEA_RX_RING_SIZE>;
+  // Get fresh network status from provider and rebuild cached notification
+  void m_refreshNetworkStatus();
   void m_sendNetworkNotify(FrameType msg_type = NETWORK_NOTIFY);
+  void m_onFrame(const Frame &frame);
   void m_handler(const Frame &frame);
-  bool m_isWaitForResponse() const { return this->m_request != nullptr; }
-  void m_resetAttempts() { this->m_remainAttempts = this->m_numAttempts; }
+  bool m_isWaitForResponse() const { return this->m_request != nullptr && !this->m_isNextStep; }
+  // Probe requests are not repeated while offline
+  void m_resetAttempts() { this->m_remainAttempts = this->isOnline() ? this->m_numAttempts : 1; }
+  void m_setAvailability(Availability value);
+  void m_onRequestFailed();
+  // Received bytes while offline: appliance may be back, next probe is sent without backoff
+  void m_onRxActivity();
+  // Put request to queue. On overflow request is completed and destroyed.
+  bool m_enqueue(RequestClass cls, Request *request);
+  // Free place for request in full queue according to overflow policy
+  bool m_makeRoom(RequestClass cls, const Request *request);
+  // Complete and destroy request removed from queue
+  void m_dropRequest(Request *request, CompletionStatus status);
+  // Take next not expired request from queue. Returns `nullptr` if queue is empty.
+  Request *m_popRequest();
+  void m_sendStep();
+  void m_completeStep();
   void m_destroyRequest();
   void m_resetTimeout();
-  void m_sendRequest(Request *request) { this->m_sendFrame(request->requestType, request->request); }
+  void m_sendRequest(Request *request) {
+    this->m_isRequestFrame = request == this->m_request;
+    this->m_sendFrame(request->requestType, request->request);
+  }
+  void m_trace(TraceDirection direction, const Frame &frame);
+  // Write pending part of TX frame
+  void m_writeFrame();
+  // Last byte of frame is written
+  void m_onFrameSent();
+  // Frame being transmitted
+  Frame m_txFrame{};
+  // Number of written bytes of TX frame
+  uint8_t m_txOffset{};
+  // TX frame has unwritten bytes
+  bool m_isSending{};
   // Frame receiver with dynamic buffer
   FrameReceiver m_receiver{};
+  // Ring of complete frames from receive thread
+  std::unique_ptr<RxRing> m_rxRing;
+  // Frame taken from RX ring
+  FrameReceiver m_rxFrame{};
+  // Frames dropped by receive thread
+  std::atomic<uint32_t> m_rxOverruns{0};
   // Network status timer
   Timer m_networkTimer{};
+  // Cached network status notification
+  NetworkNotifyData m_networkNotify{};
   // Waiting response timer
   Timer m_responseTimer{};
   // Request period timer
   Timer m_periodTimer{};
   // Queue requests
-  std::deque<Request *> m_queue;
+  Scheduler<Request *, NUM_REQUEST_CLASSES> m_queue;
   // Current request
   Request *m_request{nullptr};
+  // Communication statistics
+  Statistics m_stats{};
+  std::vector<OnAvailabilityCallback> m_availabilityCallbacks;
+  // Time of last probe request while offline
+  TimerTick m_probeTime{};
+  // Current probe interval
+  uint32_t m_probeInterval{};
+  // Consecutive failed requests
+  uint8_t m_numFailures{};
+  Availability m_availability{AVAILABILITY_ONLINE};
   // Remaining request attempts
   uint8_t m_remainAttempts{};
   // Appliance type
@@ -140,6 +467,20 @@ class ApplianceBase {
   uint8_t m_protocol{};
   // Period flag
   bool m_isBusy{};
+  // Current request has next transaction frame ready to send
+  bool m_isNextStep{};
+  // Response of current request may be sampled for RTT
+  bool m_isRttSample{};
+  // Frame being transmitted is frame of current request, not a response
+  bool m_isRequestFrame{};
+  // Time of last byte of current request frame
+  TimerTick m_requestTxTime{};
+  // Round-trip time estimator
+  RttEstimator m_rtt{250, 2000};
+#ifdef MIDEA_PROFILING
+  // Start time of last loop, us
+  uint32_t m_loopStart{};
+#endif
 
   /* ############################## */
   /* ### COMMUNICATION SETTINGS ### */
@@ -147,12 +488,35 @@ class ApplianceBase {
   
   // Stream serial interface
   Stream *m_stream;
+  // Frame trace sink
+  TraceSink *m_traceSink{nullptr};
+  // Network status provider
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+  NetworkStatusProvider *m_networkProvider{WiFiNetworkStatus::instance()};
+#else
+  NetworkStatusProvider *m_networkProvider{nullptr};
+#endif
   // Minimal period between requests
   uint32_t m_period{1000};
   // Waiting response timeout
   uint32_t m_timeout{2000};
+  // Floor of adaptive response timeout
+  uint32_t m_minTimeout{250};
   // Number of request attempts
   uint8_t m_numAttempts{3};
+  // Consecutive failed requests for going offline
+  uint8_t m_offlineThreshold{3};
+  // Range of probe interval while offline
+  uint32_t m_minProbeInterval{5 * 1000};
+  uint32_t m_maxProbeInterval{60 * 1000};
+  // Maximum number of queued requests
+  size_t m_queueCapacity{MIDEA_QUEUE_CAPACITY};
+  // Action on request to full queue
+  OverflowPolicy m_overflowPolicy{OVERFLOW_REJECT};
+  // Non-blocking write mode
+  bool m_nonBlockingWrite{};
+  // Adaptive response timeout mode
+  bool m_adaptiveTimeout{};
 };
 
 }  // namespace midea
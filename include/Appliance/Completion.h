@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include "Helpers/Timer.h"
+
+namespace dudanov {
+namespace midea {
+
+class ApplianceBase;
+
+enum CompletionStatus : uint8_t {
+  /// Operation is queued or waiting for response
+  COMPLETION_PENDING,
+  /// Appliance acknowledged operation
+  COMPLETION_OK,
+  /// No valid response after all attempts
+  COMPLETION_ERROR,
+  /// Operation was not queued
+  COMPLETION_REJECTED,
+  /// Deadline passed before operation was sent
+  COMPLETION_EXPIRED,
+  /// Operation was removed from full queue
+  COMPLETION_DROPPED,
+};
+
+class Completion;
+using CompletionCallback = std::function<void(const Completion &)>;
+
+/// Lightweight shared handle to the outcome of queued operation.
+/// Copies refer to the same operation. Default constructed handle is rejected.
+class Completion {
+ public:
+  Completion() = default;
+  /// Handle of operation that already has final status
+  static Completion resolved(CompletionStatus status);
+  /// Operation status
+  CompletionStatus getStatus() const { return this->m_state ? this->m_state->status : COMPLETION_REJECTED; }
+  bool isDone() const { return this->getStatus() != COMPLETION_PENDING; }
+  bool isSuccess() const { return this->getStatus() == COMPLETION_OK; }
+  /// Round-trip latency in ms: from first transmission to completion
+  uint32_t getLatency() const { return this->m_state ? this->m_state->latency : 0; }
+  /// Set callback on completion. Called immediately if operation is already done.
+  void then(CompletionCallback cb);
+  /// Run appliance loop until operation is done or timeout expired. Returns `true` if done.
+  /// Must be called from the same thread as appliance `loop()`.
+  bool wait(uint32_t timeout) const;
+
+ protected:
+  friend class ApplianceBase;
+  struct State {
+    ApplianceBase *appliance;
+    CompletionCallback callback;
+    TimerTick sent;
+    uint32_t latency;
+    CompletionStatus status;
+    bool isSent;
+  };
+  explicit Completion(ApplianceBase *appliance);
+  /// Mark first transmission time
+  void m_setSent();
+  /// Set final status and call callback
+  void m_complete(CompletionStatus status);
+  std::shared_ptr<State> m_state;
+};
+
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+namespace dudanov {
+namespace midea {
+
+/// Network status reported to appliance
+struct NetworkStatus {
+  bool connected;
+  /// Signal strength level: 1 (weak) .. 4 (excellent)
+  uint8_t signalStrength;
+  /// IPv4 address, first octet first
+  uint8_t ip[4];
+};
+
+/// Network status provider interface. Called out of request handling path, result is cached.
+class NetworkStatusProvider {
+ public:
+  virtual ~NetworkStatusProvider() {}
+  virtual void getStatus(NetworkStatus &status) = 0;
+};
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+/// Provider of Arduino WiFi status
+class WiFiNetworkStatus : public NetworkStatusProvider {
+ public:
+  void getStatus(NetworkStatus &status) override;
+  static WiFiNetworkStatus *instance();
+};
+#endif
+
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,60 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "Helpers/Timer.h"
+
+namespace dudanov {
+namespace midea {
+
+/// Callback with bitmask of changed fields
+using OnChangeCallback = std::function<void(uint16_t changed)>;
+
+/// Options of state subscription. Fields are bits of 16-bit mask.
+class SubscriptionOptions {
+ public:
+  static const uint8_t MAX_FIELDS = 16;
+  /// `fields` - mask of watched fields, `minInterval` - minimal period between deliveries, ms
+  SubscriptionOptions(uint16_t fields = UINT16_MAX, uint32_t minInterval = 0) : fields(fields), minInterval(minInterval) {}
+  /// Set minimal change of field value for delivery. Fields without deadband are delivered on any change.
+  SubscriptionOptions &setDeadband(uint16_t field, float deadband);
+  uint16_t fields;
+  uint32_t minInterval;
+  float deadbands[MAX_FIELDS]{};
+};
+
+/// List of filtered and rate-limited subscriptions.
+/// Changes within minimal interval are coalesced into one delivery.
+class SubscriptionList {
+ public:
+  void add(const SubscriptionOptions &options, OnChangeCallback cb);
+  bool empty() const { return this->m_items.empty(); }
+  /// Some subscriptions have changes delayed by minimal interval
+  bool isPending() const { return this->m_isPending; }
+  /// Time until delivery of delayed changes. `TimerManager::NO_DEADLINE` if nothing is pending.
+  TimerTick getNextDelay(TimerTick now) const;
+  /// Compare current field values with delivered ones and call callbacks
+  void update(const float *values, uint8_t numFields, TimerTick now);
+
+ protected:
+  struct Subscription {
+    SubscriptionOptions options;
+    OnChangeCallback cb;
+    // Last delivered values
+    float values[SubscriptionOptions::MAX_FIELDS];
+    // Time of last delivery
+    TimerTick time;
+    bool hasValues;
+    // Has changes delayed by minimal interval
+    bool isPending;
+  };
+  std::vector<Subscription> m_items;
+  // Subscriptions added by callbacks during update
+  std::vector<Subscription> m_added;
+  bool m_isPending{};
+  // Callbacks are running
+  bool m_isUpdating{};
+};
+
+}  // namespace midea
+}  // namespace dudanov
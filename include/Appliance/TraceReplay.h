@@ -0,0 +1,75 @@
+#pragma once
+#include <Arduino.h>
+#include "Appliance/ApplianceBase.h"
+#include "Frame/FrameTrace.h"
+
+namespace dudanov {
+namespace midea {
+
+/// Replay driver for binary frame traces.
+/// Acts as serial stream of appliance: RX records are fed to appliance at their recorded time,
+/// transmitted frames are compared with TX records. Timers of appliance run on virtual clock of replay.
+class TraceReplay : public Stream {
+ public:
+  TraceReplay(TraceSource *source) : m_source(source) {}
+  /// Attach appliance and switch its timers to virtual clock starting at the time of first record.
+  /// Must be called before appliance `setup()`.
+  void begin(ApplianceBase *appliance);
+  /// Restore Arduino clock of appliance
+  void end();
+  /// Replay with recorded delays (`true`) or at full speed (`false`, default)
+  void setRealTime(bool value) { this->m_realTime = value; }
+  /// Process next trace record. Returns `false` at the end of trace.
+  bool step();
+  /// Replay whole trace
+  void run() {
+    while (this->step())
+      continue;
+  }
+  /// Current virtual time
+  uint32_t getTime() const { return this->m_clock.now(); }
+  /// Number of processed records
+  uint32_t getNumRecords() const { return this->m_numRecords; }
+  /// Number of TX records that differ from transmitted frames
+  uint32_t getNumMismatches() const { return this->m_numMismatches; }
+
+  /* STREAM INTERFACE */
+
+  int available() override { return this->m_rxSize - this->m_rxPos; }
+  int read() override { return (this->m_rxPos < this->m_rxSize) ? this->m_rx[this->m_rxPos++] : -1; }
+  int peek() override { return (this->m_rxPos < this->m_rxSize) ? this->m_rx[this->m_rxPos] : -1; }
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t *data, size_t size) override;
+
+ private:
+  void m_advance(uint32_t time);
+  void m_checkTx(uint8_t size);
+  // Virtual clock of appliance
+  VirtualClock m_clock{};
+  // Trace source
+  TraceSource *m_source;
+  // Appliance under replay
+  ApplianceBase *m_appliance{nullptr};
+  // Pending RX frame
+  uint8_t m_rx[255];
+  // Transmitted and not yet compared bytes
+  uint8_t m_tx[255];
+  // Next record
+  TraceRecord m_next;
+  // Next record data
+  uint8_t m_record[255];
+  uint8_t m_rxSize{};
+  uint8_t m_rxPos{};
+  uint8_t m_txSize{};
+  // Wall time of replay start
+  uint32_t m_wallStart{};
+  // Trace time of first record
+  uint32_t m_traceStart{};
+  uint32_t m_numRecords{};
+  uint32_t m_numMismatches{};
+  bool m_realTime{};
+  bool m_hasRecord{};
+};
+
+}  // namespace midea
+}  // namespace dudanov
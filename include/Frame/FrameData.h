@@ -47,6 +47,8 @@ class NetworkNotifyData : public FrameData {
   void setConnected(bool state) { this->m_setMask(8, !state, 1); }
   void setSignalStrength(uint8_t value) { this->m_setValue(2, value); }
   void setIP(const IPAddress &ip);
+  /// Set IPv4 address from octets, first octet first
+  void setIP(const uint8_t *ip);
 };
 
 }  // namespace midea
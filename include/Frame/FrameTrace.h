@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+
+namespace dudanov {
+namespace midea {
+
+/// Direction of traced frame
+enum TraceDirection : uint8_t {
+  TRACE_RX,
+  TRACE_TX,
+};
+
+/// Trace record header. Binary layout (6 bytes, little-endian):
+/// [0..3] timestamp in ms, [4] direction, [5] frame size. Raw frame bytes follow the header.
+struct TraceRecord {
+  static const uint8_t HEADER_SIZE = 6;
+  uint32_t timestamp;
+  TraceDirection direction;
+  uint8_t size;
+  void encode(uint8_t *dst) const;
+  bool decode(const uint8_t *src);
+};
+
+/// Trace sink interface. Implementations must not keep `data` pointer after return.
+class TraceSink {
+ public:
+  virtual ~TraceSink() {}
+  virtual void write(const TraceRecord &record, const uint8_t *data) = 0;
+};
+
+/// Trace source interface. `data` must have room for 255 bytes.
+class TraceSource {
+ public:
+  virtual ~TraceSource() {}
+  /// Read next record. Returns `false` at the end of trace.
+  virtual bool read(TraceRecord &record, uint8_t *data) = 0;
+};
+
+/// Writes binary trace to any `Print` (Serial, File, ...)
+class StreamTraceSink : public TraceSink {
+ public:
+  StreamTraceSink(Print *out) : m_out(out) {}
+  void write(const TraceRecord &record, const uint8_t *data) override;
+ private:
+  Print *m_out;
+};
+
+/// Reads binary trace from any `Stream`
+class StreamTraceSource : public TraceSource {
+ public:
+  StreamTraceSource(Stream *in) : m_in(in) {}
+  bool read(TraceRecord &record, uint8_t *data) override;
+ private:
+  Stream *m_in;
+};
+
+}  // namespace midea
+}  // namespace dudanov
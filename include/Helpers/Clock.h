@@ -0,0 +1,38 @@
+#pragma once
+
+namespace dudanov {
+
+using TimerTick = unsigned long;
+
+/// Source of millisecond time for timers
+class Clock {
+ public:
+  virtual ~Clock() {}
+  /// Current time, ms
+  virtual TimerTick now() const = 0;
+  /// Nothing to do for `delay` ms. Real clock only yields, virtual clock skips this time.
+  virtual void idle(TimerTick delay) = 0;
+};
+
+/// Arduino `millis()` clock
+class ArduinoClock : public Clock {
+ public:
+  TimerTick now() const override;
+  void idle(TimerTick delay) override;
+  static ArduinoClock &instance();
+};
+
+/// Manually advanced clock for simulations and tests
+class VirtualClock : public Clock {
+ public:
+  VirtualClock(TimerTick time = 0) : m_time(time) {}
+  TimerTick now() const override { return this->m_time; }
+  void idle(TimerTick delay) override { this->m_time += delay; }
+  void set(TimerTick time) { this->m_time = time; }
+  void advance(TimerTick delay) { this->m_time += delay; }
+
+ protected:
+  TimerTick m_time;
+};
+
+}  // namespace dudanov
@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+
+namespace dudanov {
+
+/// Statistics of durations in fixed memory: count, min, average, max and log2 histogram
+/// for percentile estimation. Bucket 0 counts zero durations, bucket `n` counts [2^(n-1), 2^n) us.
+class DurationStats {
+ public:
+  static const uint8_t NUM_BUCKETS = 24;
+  /// Add duration, us
+  void add(uint32_t duration);
+  void reset() { *this = DurationStats{}; }
+  uint32_t getCount() const { return this->m_count; }
+  uint32_t getMin() const { return this->m_count ? this->m_min : 0; }
+  uint32_t getMax() const { return this->m_max; }
+  uint32_t getAverage() const { return this->m_count ? this->m_sum / this->m_count : 0; }
+  /// Upper estimate of duration percentile (0...100) from histogram, us
+  uint32_t getPercentile(uint8_t percent) const;
+  /// Number of durations in histogram bucket
+  uint32_t getBucket(uint8_t idx) const { return this->m_buckets[idx]; }
+
+ protected:
+  uint64_t m_sum{};
+  uint32_t m_count{};
+  uint32_t m_min{UINT32_MAX};
+  uint32_t m_max{};
+  uint32_t m_buckets[NUM_BUCKETS]{};
+};
+
+/// Adds lifetime of scope to statistics
+class ProfileScope {
+ public:
+  explicit ProfileScope(DurationStats &stats) : m_stats(stats), m_start(micros()) {}
+  ~ProfileScope() { this->m_stats.add(micros() - this->m_start); }
+
+ private:
+  DurationStats &m_stats;
+  uint32_t m_start;
+};
+
+}  // namespace dudanov
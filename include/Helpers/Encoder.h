@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace dudanov {
+
+/// Streaming encoder of flat maps into fixed caller buffer. No heap allocations.
+/// Output is truncated when buffer is too small, but `size()` always returns full required size.
+class Encoder {
+ public:
+  Encoder(uint8_t *buffer, size_t capacity) : m_buffer(buffer), m_capacity(capacity) {}
+  virtual ~Encoder() {}
+  /// Begin map of `count` pairs
+  virtual void beginMap(size_t count) = 0;
+  virtual void endMap() = 0;
+  virtual void key(const char *key) = 0;
+  virtual void value(bool value) = 0;
+  virtual void value(int32_t value) = 0;
+  virtual void value(float value) = 0;
+  virtual void value(const char *value) = 0;
+  template<typename T> void pair(const char *key, T value) {
+    this->key(key);
+    this->value(value);
+  }
+  /// Required buffer size for encoded data
+  size_t size() const { return this->m_size; }
+  /// Encoded data fits buffer
+  bool isComplete() const { return this->m_size <= this->m_capacity; }
+  /// Start encoding from beginning of buffer
+  virtual void reset() { this->m_size = 0; }
+
+ protected:
+  void m_put(uint8_t data) {
+    if (this->m_size < this->m_capacity)
+      this->m_buffer[this->m_size] = data;
+    ++this->m_size;
+  }
+  void m_put(const char *data, size_t size) {
+    while (size--)
+      this->m_put(static_cast<uint8_t>(*data++));
+  }
+  uint8_t *m_buffer;
+  size_t m_capacity;
+  size_t m_size{};
+};
+
+/// JSON encoder. Output has no null terminator. Floats are written with up to 2 decimals,
+/// non-finite values and values out of 32-bit integer range as `null`.
+class JsonEncoder : public Encoder {
+ public:
+  using Encoder::Encoder;
+  void beginMap(size_t count) override;
+  void endMap() override;
+  void key(const char *key) override;
+  void value(bool value) override;
+  void value(int32_t value) override;
+  void value(float value) override;
+  void value(const char *value) override;
+  void reset() override {
+    Encoder::reset();
+    this->m_isFirst = false;
+  }
+
+ protected:
+  void m_putString(const char *str);
+  void m_putInteger(uint32_t value);
+  // Next key is first in map
+  bool m_isFirst{};
+};
+
+/// CBOR (RFC 8949) encoder. Maps have definite length, floats are single precision.
+class CborEncoder : public Encoder {
+ public:
+  using Encoder::Encoder;
+  void beginMap(size_t count) override { this->m_putHead(5, count); }
+  void endMap() override {}
+  void key(const char *key) override { this->value(key); }
+  void value(bool value) override { this->m_put(value ? 0xF5 : 0xF4); }
+  void value(int32_t value) override;
+  void value(float value) override;
+  void value(const char *value) override;
+
+ protected:
+  void m_putHead(uint8_t major, uint32_t value);
+};
+
+}  // namespace dudanov
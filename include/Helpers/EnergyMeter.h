@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+
+namespace dudanov {
+
+#ifndef MIDEA_ENERGY_METER_HOURS
+#define MIDEA_ENERGY_METER_HOURS 24
+#endif
+
+#ifndef MIDEA_ENERGY_METER_DAYS
+#define MIDEA_ENERGY_METER_DAYS 31
+#endif
+
+/// Energy accounting over readings of cumulative energy counter.
+/// Integer arithmetic only, energy in Wh. Keeps rolling hourly and daily windows
+/// counted from the first reading.
+class EnergyMeter {
+ public:
+  /// `resolution` - Wh per counter unit, `modulo` - counter wraps to zero at this value
+  EnergyMeter(uint32_t resolution = 100, uint32_t modulo = 1000000) : m_resolution(resolution), m_modulo(modulo) {}
+  /// Add counter reading taken at `time` ms. Returns energy delta in Wh. Window values saturate at `UINT32_MAX`.
+  uint32_t update(uint32_t counter, uint32_t time);
+  /// Clear all accumulators
+  void reset();
+  /// Energy since first reading, Wh
+  uint64_t getTotal() const { return this->m_total; }
+  /// Energy in hour window, Wh. `idx` 0 is current hour, 1 is previous and so on.
+  uint32_t getHour(uint8_t idx = 0) const;
+  /// Energy in day window, Wh. `idx` 0 is current day, 1 is previous and so on.
+  uint32_t getDay(uint8_t idx = 0) const;
+  /// Energy in last `hours` hour windows including current, Wh
+  uint32_t getLastHours(uint8_t hours) const;
+  /// Number of detected counter resets
+  uint32_t getNumResets() const { return this->m_numResets; }
+  /// Number of detected counter wraps
+  uint32_t getNumWraps() const { return this->m_numWraps; }
+  /// Last counter reading
+  uint32_t getCounter() const { return this->m_counter; }
+  bool hasReading() const { return this->m_hasReading; }
+
+ protected:
+  static const uint32_t HOUR_MS = 60UL * 60UL * 1000UL;
+  void m_advance(uint32_t time);
+  void m_nextHour();
+  uint32_t m_hours[MIDEA_ENERGY_METER_HOURS]{};
+  uint32_t m_days[MIDEA_ENERGY_METER_DAYS]{};
+  uint64_t m_total{};
+  uint32_t m_resolution;
+  uint32_t m_modulo;
+  uint32_t m_counter{};
+  uint32_t m_time{};
+  // Elapsed time in current hour, ms
+  uint32_t m_hourPhase{};
+  uint32_t m_numResets{};
+  uint32_t m_numWraps{};
+  uint8_t m_hour{};
+  uint8_t m_day{};
+  // Hours elapsed in current day
+  uint8_t m_hourOfDay{};
+  bool m_hasReading{};
+};
+
+}  // namespace dudanov
@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace dudanov {
+
+/// Bounded lock-free multi-producer single-consumer queue.
+/// `push()` may be called from any thread, `pop()` only from one consumer thread.
+/// Capacity `N` must be a power of two.
+template<typename T, size_t N> class MpscQueue {
+  static_assert(N >= 2 && !(N & (N - 1)), "MpscQueue capacity must be a power of two");
+
+ public:
+  MpscQueue() {
+    for (size_t idx = 0; idx < N; ++idx)
+      this->m_cells[idx].seq.store(idx, std::memory_order_relaxed);
+  }
+  MpscQueue(const MpscQueue &) = delete;
+  MpscQueue &operator=(const MpscQueue &) = delete;
+
+  /// Enqueue item. Returns `false` if queue is full.
+  bool push(const T &item) {
+    size_t pos = this->m_tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    for (;;) {
+      cell = &this->m_cells[pos & (N - 1)];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (this->m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = this->m_tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->item = item;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Dequeue item. Returns `false` if queue is empty. Consumer thread only.
+  bool pop(T &item) {
+    Cell &cell = this->m_cells[this->m_head & (N - 1)];
+    const size_t seq = cell.seq.load(std::memory_order_acquire);
+    if (seq != this->m_head + 1)
+      return false;
+    item = cell.item;
+    cell.seq.store(this->m_head + N, std::memory_order_release);
+    ++this->m_head;
+    return true;
+  }
+
+ protected:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T item;
+  };
+  Cell m_cells[N];
+  std::atomic<size_t> m_tail{0};
+  // Consumer position
+  size_t m_head{0};
+};
+
+}  // namespace dudanov
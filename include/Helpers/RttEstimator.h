@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+
+namespace dudanov {
+
+/// Retransmission timeout estimator from measured round-trip times (RFC 6298).
+/// Only responses to not repeated requests must be sampled (Karn's algorithm).
+class RttEstimator {
+ public:
+  /// Timeout is limited by range [`minTimeout`, `maxTimeout`] ms
+  RttEstimator(uint32_t minTimeout = 250, uint32_t maxTimeout = 2000) : m_min(minTimeout), m_max(maxTimeout), m_rto(maxTimeout) {}
+  /// Add round-trip time sample, ms
+  void addSample(uint32_t rtt);
+  /// Double timeout after retransmission
+  void backoff();
+  /// Forget all samples
+  void reset() {
+    this->m_srtt = this->m_rttvar = 0;
+    this->m_rto = this->m_max;
+  }
+  void setLimits(uint32_t minTimeout, uint32_t maxTimeout);
+  /// Current retransmission timeout, ms
+  uint32_t getTimeout() const { return this->m_rto; }
+  /// Smoothed round-trip time, ms
+  uint32_t getSmoothedRtt() const { return this->m_srtt >> 3; }
+  /// Round-trip time variation, ms
+  uint32_t getRttVariation() const { return this->m_rttvar >> 2; }
+  bool hasSample() const { return this->m_srtt != 0; }
+
+ protected:
+  void m_update();
+  uint32_t m_min;
+  uint32_t m_max;
+  uint32_t m_rto;
+  // Smoothed RTT scaled by 8
+  uint32_t m_srtt{};
+  // RTT variation scaled by 4
+  uint32_t m_rttvar{};
+};
+
+}  // namespace dudanov
@@ -0,0 +1,70 @@
+#pragma once
+#include <deque>
+#include "Helpers/Timer.h"
+
+namespace dudanov {
+
+/// Multi-class FIFO scheduler with aging.
+/// Items are taken in FIFO order from the highest priority (lowest index) non-empty class.
+/// Head of lower priority class waiting longer than its aging limit is taken first,
+/// so no class can be starved by higher priority traffic.
+template<typename T, uint8_t N> class Scheduler {
+ public:
+  struct Entry {
+    T item;
+    TimerTick time;
+  };
+  using Queue = std::deque<Entry>;
+  /// Append item to the end of class queue
+  void push(uint8_t cls, T item, TimerTick now) { this->m_queues[cls].push_back(Entry{item, now}); }
+  /// Take next item. Scheduler must not be empty.
+  T pop(TimerTick now) { return this->pop(this->m_next(now)); }
+  /// Take head item of class. Class queue must not be empty.
+  T pop(uint8_t cls) {
+    T item = this->m_queues[cls].front().item;
+    this->m_queues[cls].pop_front();
+    return item;
+  }
+  /// Class of next item. Scheduler must not be empty.
+  uint8_t next(TimerTick now) const { return this->m_next(now); }
+  bool empty() const { return !this->size(); }
+  size_t size() const {
+    size_t size = 0;
+    for (const Queue &queue : this->m_queues)
+      size += queue.size();
+    return size;
+  }
+  size_t size(uint8_t cls) const { return this->m_queues[cls].size(); }
+  /// Set aging limit of class in ms. Zero disables aging.
+  void setAgingLimit(uint8_t cls, TimerTick limit) { this->m_agingLimits[cls] = limit; }
+  TimerTick getAgingLimit(uint8_t cls) const { return this->m_agingLimits[cls]; }
+  /// Move enqueue times of all items by `delta` ms on change of time base
+  void rebase(TimerTick delta) {
+    for (Queue &queue : this->m_queues)
+      for (Entry &entry : queue)
+        entry.time += delta;
+  }
+  /// Direct access to class queue
+  Queue &queue(uint8_t cls) { return this->m_queues[cls]; }
+  const Queue &queue(uint8_t cls) const { return this->m_queues[cls]; }
+
+ protected:
+  uint8_t m_next(TimerTick now) const {
+    uint8_t next = N;
+    for (uint8_t cls = 0; cls < N; ++cls) {
+      const Queue &queue = this->m_queues[cls];
+      if (queue.empty())
+        continue;
+      const TimerTick limit = this->m_agingLimits[cls];
+      if (limit && now - queue.front().time >= limit)
+        return cls;
+      if (next == N)
+        next = cls;
+    }
+    return next;
+  }
+  Queue m_queues[N];
+  TimerTick m_agingLimits[N]{};
+};
+
+}  // namespace dudanov
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace dudanov {
+
+/// Single-writer sequence lock for trivially copyable value.
+/// Writer never waits. Readers retry while value is being written and always get consistent copy.
+template<typename T> class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock value must be trivially copyable");
+
+ public:
+  /// Publish new value. Writer thread only.
+  void store(const T &value) {
+    uint32_t words[WORDS]{};
+    memcpy(words, &value, sizeof(T));
+    const uint32_t seq = this->m_seq.load(std::memory_order_relaxed);
+    // odd sequence: write in progress
+    this->m_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t idx = 0; idx < WORDS; ++idx)
+      this->m_data[idx].store(words[idx], std::memory_order_relaxed);
+    this->m_seq.store(seq + 2, std::memory_order_release);
+  }
+  /// Consistent copy of value. Any thread.
+  T load() const {
+    uint32_t words[WORDS];
+    uint32_t seq;
+    do {
+      seq = this->m_seq.load(std::memory_order_acquire);
+      for (size_t idx = 0; idx < WORDS; ++idx)
+        words[idx] = this->m_data[idx].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) || seq != this->m_seq.load(std::memory_order_relaxed));
+    T value;
+    memcpy(&value, words, sizeof(T));
+    return value;
+  }
+  /// Number of published values
+  uint32_t getVersion() const { return this->m_seq.load(std::memory_order_acquire) >> 1; }
+
+ protected:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+  std::atomic<uint32_t> m_seq{0};
+  std::atomic<uint32_t> m_data[WORDS]{};
+};
+
+}  // namespace dudanov
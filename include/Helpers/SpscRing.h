@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+
+namespace dudanov {
+
+/// Lock-free single-producer single-consumer ring of fixed-size slots.
+/// Producer fills slot in place: `acquire()`, then `commit()`.
+/// Consumer reads slot in place: `front()`, then `release()`.
+/// Capacity `N` must be a power of two.
+template<typename T, size_t N> class SpscRing {
+  static_assert(N >= 2 && !(N & (N - 1)), "SpscRing capacity must be a power of two");
+
+ public:
+  /// Free slot for writing or `nullptr` if ring is full. Producer thread only.
+  T *acquire() {
+    const size_t tail = this->m_tail.load(std::memory_order_relaxed);
+    if (tail - this->m_head.load(std::memory_order_acquire) >= N)
+      return nullptr;
+    return &this->m_slots[tail & (N - 1)];
+  }
+  /// Publish slot returned by `acquire()`. Producer thread only.
+  void commit() { this->m_tail.store(this->m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+  /// Oldest published slot or `nullptr` if ring is empty. Consumer thread only.
+  const T *front() const {
+    const size_t head = this->m_head.load(std::memory_order_relaxed);
+    if (head == this->m_tail.load(std::memory_order_acquire))
+      return nullptr;
+    return &this->m_slots[head & (N - 1)];
+  }
+  /// Return slot returned by `front()` to producer. Consumer thread only.
+  void release() { this->m_head.store(this->m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+ protected:
+  T m_slots[N];
+  std::atomic<size_t> m_head{0};
+  std::atomic<size_t> m_tail{0};
+};
+
+}  // namespace dudanov
@@ -2,39 +2,64 @@
 #include <cstdint>
 #include <functional>
 #include <list>
+#include "Helpers/Clock.h"
 
 namespace dudanov {
 
 class Timer;
-using TimerTick = unsigned long;
 using TimerCallback = std::function<void(Timer *)>;
 using Timers = std::list<Timer *>;
 
 class TimerManager {
  public:
+  static const TimerTick NO_DEADLINE = static_cast<TimerTick>(-1);
+  TimerManager();
+  /// Time of last `task()` call of managers on default Arduino clock
   static TimerTick ms() { return TimerManager::s_millis; }
-  void registerTimer(Timer &timer) { m_timers.push_back(&timer); }
+  /// Time of last `task()` call
+  TimerTick getTime() const { return this->m_millis; }
+  /// Current time from clock source (not cached)
+  TimerTick now() const { return this->m_clock->now(); }
+  /// Set clock source. `nullptr` restores Arduino `millis()`. Registered timers keep their remaining time.
+  /// Returns shift of time base, ms.
+  TimerTick setClock(Clock *clock);
+  Clock &getClock() const { return *this->m_clock; }
+  /// Time until expiration of the first enabled timer. `NO_DEADLINE` if all timers are stopped.
+  TimerTick getNextDelay(TimerTick now) const;
+  void registerTimer(Timer &timer);
   void task();
 
  private:
   static TimerTick s_millis;
+  Clock *m_clock;
+  TimerTick m_millis{};
   Timers m_timers;
 };
 
 class Timer {
  public:
   Timer();
-  bool isExpired() const { return TimerManager::ms() - this->m_last >= this->m_alarm; }
+  bool isExpired() const { return this->m_getTime() - this->m_last >= this->m_alarm; }
   bool isEnabled() const { return this->m_alarm; }
   void start(TimerTick ms) {
     this->m_alarm = ms;
     this->reset();
   }
   void stop() { this->m_alarm = 0; }
-  void reset() { this->m_last = TimerManager::ms(); }
+  void reset() { this->m_last = this->m_getTime(); }
   void setCallback(TimerCallback cb) { this->m_callback = cb; }
   void call() { this->m_callback(this); }
+  /// Time until expiration
+  TimerTick getRemaining(TimerTick now) const {
+    const TimerTick elapsed = now - this->m_last;
+    return (elapsed < this->m_alarm) ? this->m_alarm - elapsed : 0;
+  }
  private:
+  friend class TimerManager;
+  // Time of owner manager. Unregistered timer runs on default clock.
+  TimerTick m_getTime() const { return (this->m_manager != nullptr) ? this->m_manager->getTime() : TimerManager::ms(); }
+  // Owner of timer
+  const TimerManager *m_manager{nullptr};
   // Функция обратного вызова или лямбда
   TimerCallback m_callback;
   // Период срабатывания
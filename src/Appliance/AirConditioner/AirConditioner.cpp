@@ -1,22 +1,94 @@
 #include "Appliance/AirConditioner/AirConditioner.h"
 #include "Helpers/Timer.h"
 #include "Helpers/Log.h"
+#include <algorithm>
 
 namespace dudanov {
 namespace midea {
 namespace ac {
 
 static const char *TAG = "AirConditioner";
+static const uint32_t STATUS_LIFETIME = 5 * 1000;
 
 void AirConditioner::m_setup() {
   if (this->m_autoconfStatus != AUTOCONF_DISABLED)
     this->m_getCapabilities();
-  this->m_timerManager.registerTimer(this->m_powerUsageTimer);
-  this->m_powerUsageTimer.setCallback([this](Timer *timer) {
-    timer->reset();
-    this->m_getPowerUsage();
-  });
-  this->m_powerUsageTimer.start(30000);
+  for (uint8_t query = 0; query < NUM_POLL_QUERIES; ++query) {
+    this->m_timerManager.registerTimer(this->m_pollTimers[query]);
+    this->m_pollTimers[query].setCallback([this, query](Timer *timer) {
+      timer->reset();
+      if (!this->isOnline())
+        return;
+      if (query == POLL_POWER_USAGE)
+        this->m_getPowerUsage();
+      else
+        this->m_getIndoorHumidity();
+    });
+  }
+  this->m_isPollPlanActive = true;
+  this->m_updatePollPlan();
+}
+
+void AirConditioner::setPollInterval(PollQuery query, uint32_t interval) {
+  this->m_pollIntervals[query] = interval;
+  if (!this->m_isPollPlanActive)
+    return;
+  this->m_pollTimers[query].stop();
+  this->m_updatePollPlan();
+}
+
+bool AirConditioner::m_isSupported(PollQuery query) const {
+  const bool isKnown = this->m_autoconfStatus == AUTOCONF_OK;
+  switch (query) {
+    case POLL_POWER_USAGE:
+      return !isKnown || this->m_capabilities.powerCal();
+    case POLL_INDOOR_HUMIDITY:
+      return isKnown && this->m_capabilities.indoorHumidity();
+    default:
+      return false;
+  }
+}
+
+void AirConditioner::m_updatePollPlan() {
+  for (uint8_t query = 0; query < NUM_POLL_QUERIES; ++query) {
+    Timer &timer = this->m_pollTimers[query];
+    if (!this->m_pollIntervals[query] || !this->m_isSupported(static_cast<PollQuery>(query))) {
+      if (timer.isEnabled())
+        LOG_D(TAG, "Polling of query %d is disabled.", query);
+      timer.stop();
+    } else if (!timer.isEnabled()) {
+      timer.start(this->m_pollIntervals[query]);
+    }
+  }
+}
+
+void AirConditioner::m_loop() {
+  if (!this->m_isStateChanged && !this->m_subscriptions.isPending())
+    return;
+  this->m_isStateChanged = false;
+  MIDEA_PROFILE(PROFILE_CALLBACKS);
+  // in order of StateField bits
+  const float values[] = {
+    static_cast<float>(this->m_mode),
+    static_cast<float>(this->m_preset),
+    static_cast<float>(this->m_fanMode),
+    static_cast<float>(this->m_swingMode),
+    this->m_targetTemp,
+    this->m_indoorTemp,
+    this->m_outdoorTemp,
+    this->m_indoorHumidity,
+    this->m_powerUsage,
+  };
+  this->m_subscriptions.update(values, sizeof(values) / sizeof(values[0]), this->m_timerManager.getTime());
+}
+
+TimerTick AirConditioner::m_getNextDelay(TimerTick now) const {
+  if (this->m_isStateChanged)
+    return 0;
+  const TimerTick delay = ApplianceBase::m_getNextDelay(now);
+  if (!this->m_subscriptions.isPending())
+    return delay;
+  return std::min(delay, this->m_subscriptions.getNextDelay(now));
 }
 
 static bool checkConstraints(const Mode &mode, const Preset &preset) {
@@ -38,9 +110,9 @@ static bool checkConstraints(const Mode &mode, const Preset &preset) {
   }
 }
 
-void AirConditioner::control(const Control &control) {
+Completion AirConditioner::control(const Control &control) {
   if (this->m_sendControl)
-    return;
+    return Completion::resolved(COMPLETION_REJECTED);
   StatusData status = this->m_status;
   Mode mode = this->m_mode;
   Preset preset = this->m_preset;
@@ -78,34 +150,36 @@ void AirConditioner::control(const Control &control) {
     hasUpdate = true;
     status.setTargetTemp(control.targetTemp.value());
   }
-  if (hasUpdate) {
-    this->m_sendControl = true;
-    status.setMode(mode);
-    status.setPreset(preset);
-    status.setBeeper(this->m_beeper);
-    status.appendCRC();
-    if (isModeChanged && preset != Preset::PRESET_NONE && preset != Preset::PRESET_SLEEP) {
-      // Last command with preset
-      this->m_setStatus(status);
-      status.setPreset(Preset::PRESET_NONE);
-      status.setBeeper(false);
-      status.updateCRC();
-      // First command without preset
-      this->m_queueRequestPriority(FrameType::DEVICE_CONTROL, std::move(status),
-        // onData
-        std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1)
-      );
-    } else {
-      this->m_setStatus(std::move(status));
-    }
+  if (!hasUpdate)
+    return Completion::resolved(COMPLETION_OK);
+  this->m_sendControl = true;
+  status.setMode(mode);
+  status.setPreset(preset);
+  status.setBeeper(this->m_beeper);
+  status.appendCRC();
+  Transaction transaction;
+  if (isModeChanged && preset != Preset::PRESET_NONE && preset != Preset::PRESET_SLEEP) {
+    // First command without preset
+    StatusData first = status;
+    first.setPreset(Preset::PRESET_NONE);
+    first.setBeeper(false);
+    first.updateCRC();
+    transaction.add(FrameType::DEVICE_CONTROL, std::move(first),
+      // onData
+      std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1)
+    );
   }
+  // Last command with preset
+  transaction.add(FrameType::DEVICE_CONTROL, std::move(status),
+    // onData
+    std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1)
+  );
+  return this->m_setStatus(std::move(transaction));
 }
 
-void AirConditioner::m_setStatus(StatusData status) {
+Completion AirConditioner::m_setStatus(Transaction transaction) {
   LOG_D(TAG, "Enqueuing a priority SET_STATUS(0x40) request...");
-  this->m_queueRequestPriority(FrameType::DEVICE_CONTROL, std::move(status),
-    // onData
-    std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1),
+  return this->m_queueTransaction(CLASS_CONTROL, std::move(transaction),
     // onSuccess
     [this]() {
       this->m_sendControl = false;
@@ -118,51 +192,93 @@ void AirConditioner::m_setStatus(StatusData status) {
   );
 }
 
-void AirConditioner::setPowerState(bool state) {
-  if (state != this->getPowerState()) {
-    Control control;
-    control.mode = state ? this->m_status.getRawMode() : Mode::MODE_OFF;
-    this->control(control);
+Completion AirConditioner::setPowerState(bool state) {
+  if (state == this->getPowerState())
+    return Completion::resolved(COMPLETION_OK);
+  Control control;
+  control.mode = state ? this->m_status.getRawMode() : Mode::MODE_OFF;
+  return this->control(control);
+}
+
+void AirConditioner::m_processCommands() {
+  for (;;) {
+    if (!this->m_hasCommand && !this->m_commands.pop(this->m_command))
+      return;
+    this->m_hasCommand = true;
+    // keep order: wait for completion of previous control
+    if (this->m_sendControl && this->m_command.type != COMMAND_DISPLAY_TOGGLE)
+      return;
+    this->m_hasCommand = false;
+    switch (this->m_command.type) {
+      case COMMAND_CONTROL:
+        this->control(this->m_command.control);
+        break;
+      case COMMAND_POWER:
+        this->setPowerState(this->m_command.state);
+        break;
+      case COMMAND_DISPLAY_TOGGLE:
+        this->displayToggle();
+        break;
+    }
   }
 }
 
-void AirConditioner::m_getPowerUsage() {
+Completion AirConditioner::m_getPowerUsage() {
   QueryPowerData data{};
   LOG_D(TAG, "Enqueuing a GET_POWERUSAGE(0x41) request...");
-  this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
+  return this->m_queueRequest(CLASS_BACKGROUND, FrameType::DEVICE_QUERY, std::move(data),
     // onData
     [this](FrameData data) -> ResponseStatus {
       const auto status = data.to<StatusData>();
       if (!status.hasPowerInfo())
         return ResponseStatus::RESPONSE_WRONG;
+      this->m_energyMeter.update(status.getRawPowerUsage(), this->m_timerManager.getTime());
+      this->m_recordHistory();
       if (this->m_powerUsage != status.getPowerUsage()) {
         this->m_powerUsage = status.getPowerUsage();
-        this->sendUpdate();
+        this->m_publishState();
+        this->m_onStateChanged();
       }
       return ResponseStatus::RESPONSE_OK;
-    }
+    },
+    nullptr, nullptr,
+    this->m_pollIntervals[POLL_POWER_USAGE]
   );
 }
 
+Completion AirConditioner::m_getIndoorHumidity() {
+  LOG_D(TAG, "Enqueuing a GET_PROPERTIES(0xB1) request of indoor humidity...");
+  return this->m_queryProperties(CLASS_BACKGROUND, PropertyQueryData{PROPERTY_INDOOR_HUMIDITY},
+                                 this->m_pollIntervals[POLL_INDOOR_HUMIDITY]);
+}
+
 void AirConditioner::m_getCapabilities() {
-  GetCapabilitiesData data{};
   this->m_autoconfStatus = AUTOCONF_PROGRESS;
-  LOG_D(TAG, "Enqueuing a priority GET_CAPABILITIES(0xB5) request...");
-  this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
+  this->m_capabilities.begin();
+  this->m_capabilitiesPage = 0;
+  LOG_D(TAG, "Enqueuing a GET_CAPABILITIES(0xB5) request...");
+  this->m_requestCapabilities(CLASS_QUERY, GetCapabilitiesData{});
+}
+
+void AirConditioner::m_requestCapabilities(RequestClass cls, FrameData data) {
+  this->m_queueRequest(cls, FrameType::DEVICE_QUERY, std::move(data),
     // onData
     [this](FrameData data) -> ResponseStatus {
       if (!data.hasID(0xB5))
         return ResponseStatus::RESPONSE_WRONG;
-      if (this->m_capabilities.read(data)) {
-        GetCapabilitiesSecondData data{};
-        this->m_sendFrame(FrameType::DEVICE_QUERY, data);
-        return ResponseStatus::RESPONSE_PARTIAL;
-      }
+      this->m_hasMoreCapabilities = this->m_capabilities.read(data);
       return ResponseStatus::RESPONSE_OK;
     },
     // onSuccess
     [this]() {
+      if (this->m_hasMoreCapabilities && ++this->m_capabilitiesPage < MAX_CAPABILITIES_PAGES) {
+        LOG_D(TAG, "Enqueuing a request of the next GET_CAPABILITIES(0xB5) page...");
+        // discovery must not delay user control commands
+        this->m_requestCapabilities(CLASS_BACKGROUND, GetCapabilitiesSecondData{});
+        return;
+      }
       this->m_autoconfStatus = AUTOCONF_OK;
+      this->m_updatePollPlan();
     },
     // onError
     [this]() {
@@ -172,24 +288,57 @@ void AirConditioner::m_getCapabilities() {
   );
 }
 
-void AirConditioner::m_getStatus() {
+Completion AirConditioner::m_getStatus() {
   QueryStateData data{};
   LOG_D(TAG, "Enqueuing a GET_STATUS(0x41) request...");
-  this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
+  return this->m_queueRequest(CLASS_QUERY, FrameType::DEVICE_QUERY, std::move(data),
     // onData
-    std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1)
+    std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1),
+    nullptr, nullptr,
+    STATUS_LIFETIME
   );
 }
 
-void AirConditioner::m_displayToggle() {
+Completion AirConditioner::m_displayToggle() {
   DisplayToggleData data{};
   LOG_D(TAG, "Enqueuing a priority TOGGLE_LIGHT(0x41) request...");
-  this->m_queueRequest(FrameType::DEVICE_QUERY, std::move(data),
+  return this->m_queueRequest(CLASS_CONTROL, FrameType::DEVICE_QUERY, std::move(data),
     // onData
     std::bind(&AirConditioner::m_readStatus, this, std::placeholders::_1)
   );
 }
 
+Completion AirConditioner::queryProperties(const uint16_t *ids, uint8_t num) {
+  LOG_D(TAG, "Enqueuing a GET_PROPERTIES(0xB1) request...");
+  return this->m_queryProperties(CLASS_QUERY, PropertyQueryData(ids, num), 0);
+}
+
+Completion AirConditioner::m_queryProperties(RequestClass cls, PropertyQueryData data, uint32_t lifetime) {
+  return this->m_queueRequest(cls, FrameType::DEVICE_QUERY, std::move(data),
+    // onData
+    [this](FrameData data) -> ResponseStatus {
+      if (!data.hasID(0xB1))
+        return ResponseStatus::RESPONSE_WRONG;
+      return this->m_readProperties(std::move(data));
+    },
+    nullptr, nullptr,
+    lifetime
+  );
+}
+
+Completion AirConditioner::setProperties(PropertySetData data) {
+  LOG_D(TAG, "Enqueuing a priority SET_PROPERTIES(0xB0) request...");
+  data.appendCRC();
+  return this->m_queueRequest(CLASS_CONTROL, FrameType::DEVICE_CONTROL, std::move(data),
+    // onData
+    [this](FrameData data) -> ResponseStatus {
+      if (!data.hasID(0xB0))
+        return ResponseStatus::RESPONSE_WRONG;
+      return this->m_readProperties(std::move(data));
+    }
+  );
+}
+
 template<typename T>
 void setProperty(T &property, const T &value, bool &update) {
   if (property != value) {
@@ -217,12 +366,55 @@ ResponseStatus AirConditioner::m_readStatus(FrameData data) {
   setProperty(this->m_targetTemp, newStatus.getTargetTemp(), hasUpdate);
   setProperty(this->m_indoorTemp, newStatus.getIndoorTemp(), hasUpdate);
   setProperty(this->m_outdoorTemp, newStatus.getOutdoorTemp(), hasUpdate);
-  setProperty(this->m_indoorHumidity, newStatus.getHumiditySetpoint(), hasUpdate);
+  if (!this->m_hasHumidityProperty)
+    setProperty(this->m_indoorHumidity, newStatus.getHumiditySetpoint(), hasUpdate);
+  this->m_recordHistory();
+  this->m_publishState();
   if (hasUpdate)
-    this->sendUpdate();
+    this->m_onStateChanged();
+  return ResponseStatus::RESPONSE_OK;
+}
+
+ResponseStatus AirConditioner::m_readProperties(FrameData data) {
+  LOG_D(TAG, "New properties data received. Parsing...");
+  bool hasUpdate = false;
+  PropertyReader reader(data);
+  while (reader.next()) {
+    if (!reader.isSuccess() || !reader.size())
+      continue;
+    switch (reader.id()) {
+      case PROPERTY_INDOOR_HUMIDITY:
+        this->m_hasHumidityProperty = true;
+        setProperty(this->m_indoorHumidity, static_cast<float>(reader.data()[0]), hasUpdate);
+        break;
+      default:
+        break;
+    }
+    if (this->m_propertyCallback != nullptr)
+      this->m_propertyCallback(reader.id(), reader.data(), reader.size());
+  }
+  if (hasUpdate) {
+    this->m_publishState();
+    this->m_onStateChanged();
+  }
   return ResponseStatus::RESPONSE_OK;
 }
 
+void AirConditioner::m_publishState() {
+  State state;
+  state.targetTemp = this->m_targetTemp;
+  state.indoorTemp = this->m_indoorTemp;
+  state.outdoorTemp = this->m_outdoorTemp;
+  state.indoorHumidity = this->m_indoorHumidity;
+  state.powerUsage = this->m_powerUsage;
+  state.time = this->m_timerManager.getTime();
+  state.mode = this->m_mode;
+  state.preset = this->m_preset;
+  state.fanMode = this->m_fanMode;
+  state.swingMode = this->m_swingMode;
+  this->m_state.store(state);
+}
+
 }  // namespace ac
 }  // namespace midea
 }  // namespace dudanov
@@ -1,6 +1,7 @@
 #include "Appliance/AirConditioner/Capabilities.h"
 #include "Frame/FrameData.h"
 #include "Helpers/Log.h"
+#include <algorithm>
 
 namespace dudanov {
 namespace midea {
@@ -33,242 +34,237 @@ enum CapabilityID : uint16_t {
   CAPABILITY_BUZZER = 0x022C,
 };
 
-static uint16_t read_u16(const uint8_t *data) { return (data[1] << 8) | data[0]; }
-
-class CapabilityData {
- public:
-  CapabilityData(const FrameData &data) :
-    m_it(data.data() + 2),
-    m_end(data.data() + data.size() - 1),
-    m_num(*(data.data() + 1)) {}
-  // Get capability ID
-  CapabilityID id() const { return static_cast<CapabilityID>(read_u16(this->m_it)); }
-  // Read-only indexed access to capability data
-  const uint8_t &operator[](uint8_t idx) const { return *(this->m_it + idx + 3); }
-  // Get size of capability data
-  uint8_t size() const { return this->m_it[2]; }
-  // 
-  bool isValid() const { return m_num && this->m_available() >= 3; }
-  // One more request needed
-  bool isNeedMore() const { return this->m_available() == 2 && *this->m_it != 0; }
-  // Advance to next capability
-  void advance() {
-    this->m_it += this->size() + 3;
-    --this->m_num;
-  }
- private:
-  uint8_t m_available() const { return std::distance(this->m_it, this->m_end); }
-  // Iterator
-  const uint8_t *m_it;
-  // End of data
-  const uint8_t *const m_end;
-  // Number of capabilities in answer
-  uint8_t m_num;
-};
-
 bool Capabilities::read(const FrameData &frame) {
-  if (frame.size() < 14)
+  if (frame.size() < 3 || !frame.hasID(0xB5))
     return false;
-
-  CapabilityData cap(frame);
-
-  for (; cap.isValid(); cap.advance()) {
-    if (!cap.size())
-      continue;
-    const uint8_t uval = cap[0];
-    const bool bval = uval;
-    switch (cap.id()) {
-      case CAPABILITY_INDOOR_HUMIDITY:
-        this->m_indoorHumidity = bval;
-        break;
-      case CAPABILITY_SILKY_COOL:
-        this->m_silkyCool = bval;
-        break;
-      case CAPABILITY_SMART_EYE:
-        this->m_smartEye = uval == 1;
-        break;
-      case CAPABILITY_WIND_ON_ME:
-        this->m_windOnMe = uval == 1;
-        break;
-      case CAPABILITY_WIND_OF_ME:
-        this->m_windOfMe = uval == 1;
-        break;
-      case CAPABILITY_ACTIVE_CLEAN:
-        this->m_activeClean = uval == 1;
-        break;
-      case CAPABILITY_ONE_KEY_NO_WIND_ON_ME:
-        this->m_oneKeyNoWindOnMe = uval == 1;
-        break;
-      case CAPABILITY_BREEZE_CONTROL:
-        this->m_breezeControl = uval == 1;
-        break;
-      case CAPABILITY_FAN_SPEED_CONTROL:
-        this->m_fanSpeedControl = uval != 1;
-        break;
-      case CAPABILITY_PRESET_ECO:
-        this->m_ecoMode = uval == 1;
-        this->m_specialEco = uval == 2;
-        break;
-      case CAPABILITY_PRESET_FREEZE_PROTECTION:
-        this->m_frostProtectionMode = uval == 1;
-        break;
-      case CAPABILITY_MODES:
-        switch (uval) {
-          case 0:
-            this->m_heatMode = false;
-            this->m_coolMode = true;
-            this->m_dryMode = true;
-            this->m_autoMode = true;
-            break;
-          case 1:
-            this->m_coolMode = true;
-            this->m_heatMode= true;
-            this->m_dryMode = true;
-            this->m_autoMode = true;
-            break;
-          case 2:
-            this->m_coolMode = false;
-            this->m_dryMode = false;
-            this->m_heatMode = true;
-            this->m_autoMode = true;
-            break;
-          case 3:
-            this->m_coolMode = true;
-            this->m_dryMode = false;
-            this->m_heatMode = false;
-            this->m_autoMode = false;
-            break;
-        }
-        break;
-      case CAPABILITY_SWING_MODES:
-        switch (uval) {
-          case 0:
-            this->m_leftrightFan = false;
-            this->m_updownFan = true;
-            break;
-          case 1:
-            this->m_leftrightFan = true;
-            this->m_updownFan = true;
-            break;
-          case 2:
-            this->m_leftrightFan = false;
-            this->m_updownFan = false;
-            break;
-          case 3:
-            this->m_leftrightFan = true;
-            this->m_updownFan = false;
-            break;
-        }
-        break;
-      case CAPABILITY_POWER:
-        switch (uval) {
-          case 0:
-          case 1:
-            this->m_powerCal = false;
-            this->m_powerCalSetting = false;
-            break;
-          case 2:
-            this->m_powerCal = true;
-            this->m_powerCalSetting = false;
-            break;
-          case 3:
-            this->m_powerCal = true;
-            this->m_powerCalSetting = true;
-            break;
-        }
-        break;
-      case CAPABILITY_NEST:
-        switch (uval) {
-          case 0:
-            this->m_nestCheck = false;
-            this->m_nestNeedChange = false;
-            break;
-          case 1:
-          case 2:
-            this->m_nestCheck = true;
-            this->m_nestNeedChange = false;
-            break;
-          case 3:
-            this->m_nestCheck = false;
-            this->m_nestNeedChange = true;
-            break;
-          case 4:
-            this->m_nestCheck = true;
-            this->m_nestNeedChange = true;
-            break;
-        }
-        break;
-      case CAPABILITY_AUX_ELECTRIC_HEATING:
-        this->m_electricAuxHeating = bval;
-        break;
-      case CAPABILITY_PRESET_TURBO:
-        switch (uval) {
-          case 0:
-            this->m_turboHeat = false;
-            this->m_turboCool = true;
-            break;
-          case 1:
-            this->m_turboHeat = true;
-            this->m_turboCool = true;
-            break;
-          case 2:
-            this->m_turboHeat = false;
-            this->m_turboCool = false;
-            break;
-           case 3:
-            this->m_turboHeat = true;
-            this->m_turboCool = false;
-            break;
-        }
-        break;
-      case CAPABILITY_HUMIDITY:
-        switch (uval) {
-          case 0:
-            this->m_autoSetHumidity = false;
-            this->m_manualSetHumidity = false;
-            break;
-          case 1:
-            this->m_autoSetHumidity = true;
-            this->m_manualSetHumidity = false;
-            break;
-          case 2:
-            this->m_autoSetHumidity = true;
-            this->m_manualSetHumidity = true;
-            break;
-          case 3:
-            this->m_autoSetHumidity = false;
-            this->m_manualSetHumidity = true;
-            break;
-        }
-        break;
-      case CAPABILITY_UNIT_CHANGEABLE:
-        this->m_unitChangeable = !bval;
-        break;
-      case CAPABILITY_LIGHT_CONTROL:
-        this->m_lightControl = bval;
-        break;
-      case CAPABILITY_TEMPERATURES:
-        if (cap.size() >= 6) {
-          this->m_minTempCool = static_cast<float>(uval) * 0.5f;
-          this->m_maxTempCool = static_cast<float>(cap[1]) * 0.5f;
-          this->m_minTempAuto = static_cast<float>(cap[2]) * 0.5f;
-          this->m_maxTempAuto = static_cast<float>(cap[3]) * 0.5f;
-          this->m_minTempHeat = static_cast<float>(cap[4]) * 0.5f;
-          this->m_maxTempHeat = static_cast<float>(cap[5]) * 0.5f;
-          this->m_decimals = (cap.size() > 6) ? cap[6] : cap[2];
-        }
-        break;
-      case CAPABILITY_BUZZER:
-        this->m_buzzer = bval;
+  const uint8_t *it = frame.data() + 2;
+  // CRC is not included
+  const uint8_t *const end = frame.data() + frame.size() - 1;
+  // number of records starting in this page
+  uint8_t num = frame.data()[1];
+  while (it != end) {
+    if (!this->m_recordSize) {
+      // two bytes tail is not a record
+      if (!num || end - it < 3)
         break;
+      --num;
     }
+    if (!this->m_parseRecord(it, end))
+      return true;  // record continues in next page
   }
+  // at least two unread bytes: if first is not zero, next page must be requested
+  return end - it == 2 && *it != 0;
+}
 
-  // Как минимум указывает на предпоследний элемент (минимум 2 непрочитанных байта)
-  if (cap.isNeedMore())
-    return true; // если предпоследний байт != 0, то нужно опрашивать дальше
+bool Capabilities::m_parseRecord(const uint8_t *&it, const uint8_t *end) {
+  for (; it != end; ++it) {
+    // header is id_lo, id_hi, size
+    const uint16_t recordSize = (this->m_recordSize < 3) ? 3 : 3 + this->m_record[2];
+    if (this->m_recordSize >= recordSize)
+      break;
+    // data out of buffer is skipped
+    if (this->m_recordSize < sizeof(this->m_record))
+      this->m_record[this->m_recordSize] = *it;
+    ++this->m_recordSize;
+  }
+  if (this->m_recordSize < 3 || this->m_recordSize < 3 + this->m_record[2])
+    return false;
+  const uint8_t size = std::min<uint8_t>(this->m_record[2], sizeof(this->m_record) - 3);
+  this->m_apply(this->m_record[0] | (this->m_record[1] << 8), this->m_record + 3, size);
+  this->m_recordSize = 0;
+  return true;
+}
 
-  return false;
+void Capabilities::m_apply(uint16_t id, const uint8_t *data, uint8_t size) {
+  if (!size)
+    return;
+  const uint8_t uval = data[0];
+  const bool bval = uval;
+  switch (id) {
+    case CAPABILITY_INDOOR_HUMIDITY:
+      this->m_indoorHumidity = bval;
+      break;
+    case CAPABILITY_SILKY_COOL:
+      this->m_silkyCool = bval;
+      break;
+    case CAPABILITY_SMART_EYE:
+      this->m_smartEye = uval == 1;
+      break;
+    case CAPABILITY_WIND_ON_ME:
+      this->m_windOnMe = uval == 1;
+      break;
+    case CAPABILITY_WIND_OF_ME:
+      this->m_windOfMe = uval == 1;
+      break;
+    case CAPABILITY_ACTIVE_CLEAN:
+      this->m_activeClean = uval == 1;
+      break;
+    case CAPABILITY_ONE_KEY_NO_WIND_ON_ME:
+      this->m_oneKeyNoWindOnMe = uval == 1;
+      break;
+    case CAPABILITY_BREEZE_CONTROL:
+      this->m_breezeControl = uval == 1;
+      break;
+    case CAPABILITY_FAN_SPEED_CONTROL:
+      this->m_fanSpeedControl = uval != 1;
+      break;
+    case CAPABILITY_PRESET_ECO:
+      this->m_ecoMode = uval == 1;
+      this->m_specialEco = uval == 2;
+      break;
+    case CAPABILITY_PRESET_FREEZE_PROTECTION:
+      this->m_frostProtectionMode = uval == 1;
+      break;
+    case CAPABILITY_MODES:
+      switch (uval) {
+        case 0:
+          this->m_heatMode = false;
+          this->m_coolMode = true;
+          this->m_dryMode = true;
+          this->m_autoMode = true;
+          break;
+        case 1:
+          this->m_coolMode = true;
+          this->m_heatMode= true;
+          this->m_dryMode = true;
+          this->m_autoMode = true;
+          break;
+        case 2:
+          this->m_coolMode = false;
+          this->m_dryMode = false;
+          this->m_heatMode = true;
+          this->m_autoMode = true;
+          break;
+        case 3:
+          this->m_coolMode = true;
+          this->m_dryMode = false;
+          this->m_heatMode = false;
+          this->m_autoMode = false;
+          break;
+      }
+      break;
+    case CAPABILITY_SWING_MODES:
+      switch (uval) {
+        case 0:
+          this->m_leftrightFan = false;
+          this->m_updownFan = true;
+          break;
+        case 1:
+          this->m_leftrightFan = true;
+          this->m_updownFan = true;
+          break;
+        case 2:
+          this->m_leftrightFan = false;
+          this->m_updownFan = false;
+          break;
+        case 3:
+          this->m_leftrightFan = true;
+          this->m_updownFan = false;
+          break;
+      }
+      break;
+    case CAPABILITY_POWER:
+      switch (uval) {
+        case 0:
+        case 1:
+          this->m_powerCal = false;
+          this->m_powerCalSetting = false;
+          break;
+        case 2:
+          this->m_powerCal = true;
+          this->m_powerCalSetting = false;
+          break;
+        case 3:
+          this->m_powerCal = true;
+          this->m_powerCalSetting = true;
+          break;
+      }
+      break;
+    case CAPABILITY_NEST:
+      switch (uval) {
+        case 0:
+          this->m_nestCheck = false;
+          this->m_nestNeedChange = false;
+          break;
+        case 1:
+        case 2:
+          this->m_nestCheck = true;
+          this->m_nestNeedChange = false;
+          break;
+        case 3:
+          this->m_nestCheck = false;
+          this->m_nestNeedChange = true;
+          break;
+        case 4:
+          this->m_nestCheck = true;
+          this->m_nestNeedChange = true;
+          break;
+      }
+      break;
+    case CAPABILITY_AUX_ELECTRIC_HEATING:
+      this->m_electricAuxHeating = bval;
+      break;
+    case CAPABILITY_PRESET_TURBO:
+      switch (uval) {
+        case 0:
+          this->m_turboHeat = false;
+          this->m_turboCool = true;
+          break;
+        case 1:
+          this->m_turboHeat = true;
+          this->m_turboCool = true;
+          break;
+        case 2:
+          this->m_turboHeat = false;
+          this->m_turboCool = false;
+          break;
+         case 3:
+          this->m_turboHeat = true;
+          this->m_turboCool = false;
+          break;
+      }
+      break;
+    case CAPABILITY_HUMIDITY:
+      switch (uval) {
+        case 0:
+          this->m_autoSetHumidity = false;
+          this->m_manualSetHumidity = false;
+          break;
+        case 1:
+          this->m_autoSetHumidity = true;
+          this->m_manualSetHumidity = false;
+          break;
+        case 2:
+          this->m_autoSetHumidity = true;
+          this->m_manualSetHumidity = true;
+          break;
+        case 3:
+          this->m_autoSetHumidity = false;
+          this->m_manualSetHumidity = true;
+          break;
+      }
+      break;
+    case CAPABILITY_UNIT_CHANGEABLE:
+      this->m_unitChangeable = !bval;
+      break;
+    case CAPABILITY_LIGHT_CONTROL:
+      this->m_lightControl = bval;
+      break;
+    case CAPABILITY_TEMPERATURES:
+      if (size >= 6) {
+        this->m_minTempCool = static_cast<float>(uval) * 0.5f;
+        this->m_maxTempCool = static_cast<float>(data[1]) * 0.5f;
+        this->m_minTempAuto = static_cast<float>(data[2]) * 0.5f;
+        this->m_maxTempAuto = static_cast<float>(data[3]) * 0.5f;
+        this->m_minTempHeat = static_cast<float>(data[4]) * 0.5f;
+        this->m_maxTempHeat = static_cast<float>(data[5]) * 0.5f;
+        this->m_decimals = (size > 6) ? data[6] : data[2];
+      }
+      break;
+    case CAPABILITY_BUZZER:
+      this->m_buzzer = bval;
+      break;
+  }
 }
 
 #define LOG_CAPABILITY(str, condition) \
@@ -0,0 +1,47 @@
+#include "Appliance/AirConditioner/PropertyData.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+PropertyQueryData::PropertyQueryData(const uint16_t *ids, uint8_t num) : FrameData({0xB1, 0x00}) {
+  if (num > MAX_PROPERTIES)
+    num = MAX_PROPERTIES;
+  this->m_data[1] = num;
+  for (; num; --num, ++ids) {
+    this->m_data.push_back(*ids & 0xFF);
+    this->m_data.push_back(*ids >> 8);
+  }
+  this->appendCRC();
+}
+
+bool PropertySetData::add(uint16_t id, const uint8_t *data, uint8_t size) {
+  // room for CRC is reserved
+  if (this->m_data.size() + size + 4 >= UINT8_MAX)
+    return false;
+  this->m_data.push_back(id & 0xFF);
+  this->m_data.push_back(id >> 8);
+  this->m_data.push_back(size);
+  this->m_data.insert(this->m_data.end(), data, data + size);
+  ++this->m_data[1];
+  return true;
+}
+
+PropertyReader::PropertyReader(const FrameData &data)
+    : m_next(data.data() + 2), m_end(data.data() + data.size() - 1), m_num(data.size() > 3 ? data.data()[1] : 0) {}
+
+bool PropertyReader::next() {
+  if (!this->m_num || this->m_end - this->m_next < 4)
+    return false;
+  const uint8_t *it = this->m_next;
+  if (this->m_end - it - 4 < it[3])
+    return false;
+  --this->m_num;
+  this->m_it = it;
+  this->m_next = it + 4 + it[3];
+  return true;
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,147 @@
+#ifdef __linux__
+#include "Appliance/AirConditioner/SharedTable.h"
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+static size_t tableSize(uint16_t numSlots) { return sizeof(SharedHeader) + numSlots * sizeof(SharedSlot); }
+
+// Clears magic of existing table, so readers mapping it see it as stale
+static void retireTable(const char *name) {
+  const int fd = shm_open(name, O_RDWR, 0);
+  if (fd < 0)
+    return;
+  struct stat st;
+  void *addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(SharedHeader))
+    addr = mmap(nullptr, sizeof(SharedHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return;
+  const auto header = static_cast<SharedHeader *>(addr);
+  if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SharedHeader::MAGIC)
+    __atomic_store_n(&header->magic, 0, __ATOMIC_RELEASE);
+  munmap(addr, sizeof(SharedHeader));
+}
+
+bool SharedTableWriter::open(const char *name, uint16_t numSlots) {
+  this->close();
+  // never resize mapped table in place: readers would fault or read past their mapping
+  SharedTableWriter::unlink(name);
+  const int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    return false;
+  const size_t size = tableSize(numSlots);
+  void *addr = MAP_FAILED;
+  if (ftruncate(fd, size) == 0)
+    addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+  this->m_size = size;
+  this->m_header = static_cast<SharedHeader *>(addr);
+  // invalidate header while slots are initialized
+  this->m_header->magic = 0;
+  this->m_slots = reinterpret_cast<SharedSlot *>(this->m_header + 1);
+  for (uint16_t idx = 0; idx < numSlots; ++idx)
+    new (&this->m_slots[idx]) SharedSlot();
+  this->m_header->version = SharedHeader::VERSION;
+  this->m_header->numSlots = numSlots;
+  this->m_header->slotSize = sizeof(SharedSlot);
+  this->m_header->reserved = 0;
+  __atomic_store_n(&this->m_header->magic, SharedHeader::MAGIC, __ATOMIC_RELEASE);
+  return true;
+}
+
+void SharedTableWriter::close() {
+  if (this->m_header == nullptr)
+    return;
+  munmap(this->m_header, this->m_size);
+  this->m_header = nullptr;
+  this->m_slots = nullptr;
+}
+
+bool SharedTableWriter::unlink(const char *name) {
+  retireTable(name);
+  return shm_unlink(name) == 0;
+}
+
+bool SharedTableWriter::publish(uint16_t slot, const AirConditioner &appliance, const char *name) {
+  if (this->m_header == nullptr || slot >= this->m_header->numSlots)
+    return false;
+  SharedRecord record{};
+  strncpy(record.name, name, sizeof(record.name) - 1);
+  record.state = appliance.getState();
+  record.stats = appliance.getStatistics();
+  record.availability = appliance.getAvailability();
+  record.autoconf = appliance.getAutoconfStatus();
+  record.used = true;
+  this->m_slots[slot].store(record);
+  return true;
+}
+
+bool SharedTableWriter::clear(uint16_t slot) {
+  if (this->m_header == nullptr || slot >= this->m_header->numSlots)
+    return false;
+  this->m_slots[slot].store(SharedRecord{});
+  return true;
+}
+
+bool SharedTableReader::open(const char *name) {
+  this->close();
+  const int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  void *addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(SharedHeader))
+    addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+  const auto header = static_cast<const SharedHeader *>(addr);
+  const bool isValid = __atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SharedHeader::MAGIC;
+  // read once: all later accesses are checked against this value
+  const uint16_t numSlots = header->numSlots;
+  if (!isValid || header->version != SharedHeader::VERSION || header->slotSize != sizeof(SharedSlot) ||
+      tableSize(numSlots) > static_cast<size_t>(st.st_size)) {
+    munmap(addr, st.st_size);
+    return false;
+  }
+  this->m_size = st.st_size;
+  this->m_header = header;
+  this->m_slots = reinterpret_cast<const SharedSlot *>(header + 1);
+  this->m_numSlots = numSlots;
+  return true;
+}
+
+void SharedTableReader::close() {
+  if (this->m_header == nullptr)
+    return;
+  munmap(const_cast<SharedHeader *>(this->m_header), this->m_size);
+  this->m_header = nullptr;
+  this->m_slots = nullptr;
+  this->m_numSlots = 0;
+}
+
+bool SharedTableReader::isStale() const {
+  return this->m_header == nullptr || __atomic_load_n(&this->m_header->magic, __ATOMIC_ACQUIRE) != SharedHeader::MAGIC;
+}
+
+bool SharedTableReader::read(uint16_t slot, SharedRecord &record) const {
+  if (slot >= this->m_numSlots)
+    return false;
+  record = this->m_slots[slot].load();
+  return record.used;
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
+#endif
@@ -0,0 +1,172 @@
+#include "Appliance/AirConditioner/StateEncoder.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+static const char *modeName(Mode mode) {
+  switch (mode) {
+    case Mode::MODE_OFF:
+      return "off";
+    case Mode::MODE_AUTO:
+      return "auto";
+    case Mode::MODE_COOL:
+      return "cool";
+    case Mode::MODE_DRY:
+      return "dry";
+    case Mode::MODE_HEAT:
+      return "heat";
+    case Mode::MODE_FAN_ONLY:
+      return "fan_only";
+    default:
+      return "unknown";
+  }
+}
+
+static const char *presetName(Preset preset) {
+  switch (preset) {
+    case Preset::PRESET_NONE:
+      return "none";
+    case Preset::PRESET_SLEEP:
+      return "sleep";
+    case Preset::PRESET_TURBO:
+      return "turbo";
+    case Preset::PRESET_ECO:
+      return "eco";
+    case Preset::PRESET_FREEZE_PROTECTION:
+      return "freeze_protection";
+    default:
+      return "unknown";
+  }
+}
+
+static const char *swingName(SwingMode swing) {
+  switch (swing) {
+    case SwingMode::SWING_OFF:
+      return "off";
+    case SwingMode::SWING_BOTH:
+      return "both";
+    case SwingMode::SWING_VERTICAL:
+      return "vertical";
+    case SwingMode::SWING_HORIZONTAL:
+      return "horizontal";
+    default:
+      return "unknown";
+  }
+}
+
+static void encodeFanMode(Encoder &encoder, FanMode fan) {
+  switch (fan) {
+    case FanMode::FAN_AUTO:
+      return encoder.value("auto");
+    case FanMode::FAN_SILENT:
+      return encoder.value("silent");
+    case FanMode::FAN_LOW:
+      return encoder.value("low");
+    case FanMode::FAN_MEDIUM:
+      return encoder.value("medium");
+    case FanMode::FAN_HIGH:
+      return encoder.value("high");
+    case FanMode::FAN_TURBO:
+      return encoder.value("turbo");
+    default:
+      // custom speed in percents
+      return encoder.value(static_cast<int32_t>(fan));
+  }
+}
+
+size_t encodeState(Encoder &encoder, const State &state, uint16_t fields) {
+  fields &= FIELD_ALL;
+  size_t count = 0;
+  for (uint16_t mask = fields; mask; mask &= mask - 1)
+    ++count;
+  encoder.beginMap(count);
+  if (fields & FIELD_MODE)
+    encoder.pair("mode", modeName(state.mode));
+  if (fields & FIELD_PRESET)
+    encoder.pair("preset", presetName(state.preset));
+  if (fields & FIELD_FAN_MODE) {
+    encoder.key("fan_mode");
+    encodeFanMode(encoder, state.fanMode);
+  }
+  if (fields & FIELD_SWING_MODE)
+    encoder.pair("swing_mode", swingName(state.swingMode));
+  if (fields & FIELD_TARGET_TEMP)
+    encoder.pair("target_temp", state.targetTemp);
+  if (fields & FIELD_INDOOR_TEMP)
+    encoder.pair("indoor_temp", state.indoorTemp);
+  if (fields & FIELD_OUTDOOR_TEMP)
+    encoder.pair("outdoor_temp", state.outdoorTemp);
+  if (fields & FIELD_INDOOR_HUM)
+    encoder.pair("indoor_humidity", state.indoorHumidity);
+  if (fields & FIELD_POWER_USAGE)
+    encoder.pair("power_usage", state.powerUsage);
+  encoder.endMap();
+  return encoder.size();
+}
+
+struct CapabilityFlag {
+  const char *name;
+  bool (Capabilities::*get)() const;
+};
+
+struct CapabilityValue {
+  const char *name;
+  float (Capabilities::*get)() const;
+};
+
+static const CapabilityFlag CAPABILITY_FLAGS[] = {
+  {"auto_mode", &Capabilities::supportAutoMode},
+  {"cool_mode", &Capabilities::supportCoolMode},
+  {"heat_mode", &Capabilities::supportHeatMode},
+  {"dry_mode", &Capabilities::supportDryMode},
+  {"eco_preset", &Capabilities::supportEcoPreset},
+  {"turbo_preset", &Capabilities::supportTurboPreset},
+  {"frost_protection_preset", &Capabilities::supportFrostProtectionPreset},
+  {"vertical_swing", &Capabilities::supportVerticalSwing},
+  {"horizontal_swing", &Capabilities::supportHorizontalSwing},
+  {"light_control", &Capabilities::supportLightControl},
+  {"fan_speed_control", &Capabilities::fanSpeedControl},
+  {"indoor_humidity", &Capabilities::indoorHumidity},
+  {"auto_set_humidity", &Capabilities::autoSetHumidity},
+  {"manual_set_humidity", &Capabilities::manualSetHumidity},
+  {"power_cal", &Capabilities::powerCal},
+  {"power_cal_setting", &Capabilities::powerCalSetting},
+  {"decimals", &Capabilities::decimals},
+  {"buzzer", &Capabilities::buzzer},
+  {"active_clean", &Capabilities::activeClean},
+  {"breeze_control", &Capabilities::breezeControl},
+  {"electric_aux_heating", &Capabilities::electricAuxHeating},
+  {"nest_check", &Capabilities::nestCheck},
+  {"nest_need_change", &Capabilities::nestNeedChange},
+  {"one_key_no_wind_on_me", &Capabilities::oneKeyNoWindOnMe},
+  {"silky_cool", &Capabilities::silkyCool},
+  {"smart_eye", &Capabilities::smartEye},
+  {"unit_changeable", &Capabilities::unitChangeable},
+  {"wind_of_me", &Capabilities::windOfMe},
+  {"wind_on_me", &Capabilities::windOnMe},
+};
+
+static const CapabilityValue CAPABILITY_VALUES[] = {
+  {"min_temp_auto", &Capabilities::minTempAuto},
+  {"max_temp_auto", &Capabilities::maxTempAuto},
+  {"min_temp_cool", &Capabilities::minTempCool},
+  {"max_temp_cool", &Capabilities::maxTempCool},
+  {"min_temp_heat", &Capabilities::minTempHeat},
+  {"max_temp_heat", &Capabilities::maxTempHeat},
+};
+
+size_t encodeCapabilities(Encoder &encoder, const Capabilities &capabilities) {
+  encoder.beginMap(sizeof(CAPABILITY_FLAGS) / sizeof(CAPABILITY_FLAGS[0]) +
+                   sizeof(CAPABILITY_VALUES) / sizeof(CAPABILITY_VALUES[0]));
+  for (const CapabilityFlag &flag : CAPABILITY_FLAGS)
+    encoder.pair(flag.name, (capabilities.*flag.get)());
+  for (const CapabilityValue &value : CAPABILITY_VALUES)
+    encoder.pair(value.name, (capabilities.*value.get)());
+  encoder.endMap();
+  return encoder.size();
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,157 @@
+#include "Appliance/AirConditioner/StateHistory.h"
+
+namespace dudanov {
+namespace midea {
+namespace ac {
+
+static const uint8_t PARTIAL_FLAG = 0x80;
+
+static int16_t clamp16(int32_t value) {
+  if (value > INT16_MAX)
+    return INT16_MAX;
+  if (value < INT16_MIN)
+    return INT16_MIN;
+  return static_cast<int16_t>(value);
+}
+
+static int16_t toDeci(float value) { return static_cast<int16_t>(value * 10.0F + ((value < 0) ? -0.5F : 0.5F)); }
+
+bool HistorySample::isSameState(const HistorySample &other) const {
+  return this->indoorTemp == other.indoorTemp && this->outdoorTemp == other.outdoorTemp &&
+         this->targetTemp == other.targetTemp && this->powerUsage == other.powerUsage && this->mode == other.mode;
+}
+
+HistoryBuffer::Iterator::Iterator(const HistoryBuffer *buffer, uint16_t idx) : m_buffer(buffer), m_idx(idx) {
+  if (idx == UINT16_MAX)
+    return;
+  this->m_sample = buffer->m_base;
+  this->m_skipPartial(buffer->m_basePartial);
+}
+
+HistoryBuffer::Iterator &HistoryBuffer::Iterator::operator++() {
+  if (this->m_idx >= this->m_buffer->m_count) {
+    this->m_idx = UINT16_MAX;
+    return *this;
+  }
+  this->m_skipPartial(true);
+  return *this;
+}
+
+void HistoryBuffer::Iterator::m_skipPartial(bool partial) {
+  while (partial && this->m_idx < this->m_buffer->m_count) {
+    const HistoryRecord &record = this->m_buffer->m_record(this->m_idx++);
+    HistoryBuffer::m_apply(this->m_sample, record);
+    partial = record.mode & PARTIAL_FLAG;
+  }
+}
+
+size_t HistoryBuffer::query(uint32_t from, uint32_t to, HistorySample *out, size_t size) const {
+  size_t num = 0;
+  for (const HistorySample &sample : *this) {
+    if (sample.time > to || num >= size)
+      break;
+    if (sample.time >= from)
+      out[num++] = sample;
+  }
+  return num;
+}
+
+void HistoryBuffer::push(const HistorySample &sample) {
+  if (!this->m_hasBase) {
+    this->m_base = this->m_last = sample;
+    this->m_hasBase = true;
+    this->m_basePartial = false;
+    return;
+  }
+  HistorySample current = this->m_last;
+  uint32_t dt = sample.time - current.time;
+  // sample is split to several records if deltas don't fit
+  for (;;) {
+    HistoryRecord record;
+    record.dt = (dt > UINT16_MAX) ? UINT16_MAX : dt;
+    dt -= record.dt;
+    record.indoorTemp = clamp16(sample.indoorTemp - current.indoorTemp);
+    record.outdoorTemp = clamp16(sample.outdoorTemp - current.outdoorTemp);
+    record.targetTemp = clamp16(sample.targetTemp - current.targetTemp);
+    record.powerUsage = clamp16(static_cast<int32_t>(sample.powerUsage - current.powerUsage));
+    record.mode = sample.mode;
+    HistoryBuffer::m_apply(current, record);
+    const bool done = !dt && current.isSameState(sample);
+    if (!done)
+      record.mode |= PARTIAL_FLAG;
+    this->m_append(record);
+    if (done)
+      break;
+  }
+  this->m_last = sample;
+}
+
+void HistoryBuffer::m_append(const HistoryRecord &record) {
+  if (this->m_count == this->m_capacity) {
+    // merge oldest record into first sample
+    const HistoryRecord &oldest = this->m_records[this->m_head];
+    HistoryBuffer::m_apply(this->m_base, oldest);
+    this->m_basePartial = oldest.mode & PARTIAL_FLAG;
+    this->m_head = (this->m_head + 1) % this->m_capacity;
+    --this->m_count;
+  }
+  this->m_records[(this->m_head + this->m_count) % this->m_capacity] = record;
+  ++this->m_count;
+}
+
+void HistoryBuffer::m_apply(HistorySample &sample, const HistoryRecord &record) {
+  sample.time += record.dt;
+  sample.indoorTemp += record.indoorTemp;
+  sample.outdoorTemp += record.outdoorTemp;
+  sample.targetTemp += record.targetTemp;
+  sample.powerUsage += static_cast<int32_t>(record.powerUsage);
+  sample.mode = static_cast<Mode>(record.mode & ~PARTIAL_FLAG);
+}
+
+void StateHistory::record(float indoorTemp, float outdoorTemp, float targetTemp, uint32_t powerUsage, Mode mode, uint32_t ms) {
+  if (this->m_hasCurrent) {
+    this->m_msRemainder += ms - this->m_ms;
+    this->m_seconds += this->m_msRemainder / 1000;
+    this->m_msRemainder %= 1000;
+  }
+  this->m_ms = ms;
+  const HistorySample sample{this->m_seconds, toDeci(indoorTemp), toDeci(outdoorTemp), toDeci(targetTemp), powerUsage, mode};
+  if (!this->m_hasCurrent) {
+    this->m_hasCurrent = true;
+    this->m_current = sample;
+    this->m_raw.push(sample);
+    return;
+  }
+  // closing of minute and hour: push last state held in them
+  HistorySample held = this->m_current;
+  if (sample.time / 60 != held.time / 60) {
+    held.time -= held.time % 60;
+    if (this->m_minute.empty() || !this->m_minute.last().isSameState(held))
+      this->m_minute.push(held);
+  }
+  held = this->m_current;
+  if (sample.time / 3600 != held.time / 3600) {
+    held.time -= held.time % 3600;
+    if (this->m_hour.empty() || !this->m_hour.last().isSameState(held))
+      this->m_hour.push(held);
+  }
+  if (!sample.isSameState(this->m_current)) {
+    this->m_current = sample;
+    this->m_raw.push(sample);
+  }
+}
+
+const HistoryBuffer &StateHistory::get(HistoryTier tier) const {
+  switch (tier) {
+    case HISTORY_MINUTE:
+      return this->m_minute;
+    case HISTORY_HOUR:
+      return this->m_hour;
+    default:
+      return this->m_raw;
+  }
+}
+
+}  // namespace ac
+}  // namespace midea
+}  // namespace dudanov
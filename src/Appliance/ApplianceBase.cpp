@@ -1,10 +1,7 @@
 #include "Appliance/ApplianceBase.h"
 #include "Helpers/Log.h"
-#ifdef ARDUINO_ARCH_ESP32
-#include <WiFi.h>
-#else
-#include <ESP8266WiFi.h>
-#endif
+#include <algorithm>
+#include <cinttypes>
 
 namespace dudanov {
 namespace midea {
@@ -19,32 +16,100 @@ ResponseStatus ApplianceBase::Request::callHandler(const Frame &frame) {
   return this->onData(frame.getData());
 }
 
-bool ApplianceBase::FrameReceiver::read(Stream *stream) {
+bool ApplianceBase::Request::advance() {
+  if (this->nextStep >= this->steps.size())
+    return false;
+  Transaction::Step &step = this->steps[this->nextStep++];
+  this->request = std::move(step.data);
+  this->onData = std::move(step.onData);
+  this->requestType = step.type;
+  return true;
+}
+
+bool ApplianceBase::FrameReceiver::read(Stream *stream, Clock &clock) {
+  if (!stream->available()) {
+    // line is idle: check inter-byte gap
+    if (this->m_timeout && clock.now() - this->m_lastByte >= this->m_timeout) {
+      if (!this->m_data.empty()) {
+        LOG_D(TAG, "Inter-byte timeout. Partial frame discarded.");
+        this->m_discard();
+      }
+      this->m_isSyncLost = false;
+    }
+    return false;
+  }
+  if (this->m_timeout)
+    this->m_lastByte = clock.now();
   while (stream->available()) {
     const uint8_t data = stream->read();
+    if (this->m_isSyncLost)
+      continue;
     const uint8_t length = this->m_data.size();
-    if (length == OFFSET_START && data != START_BYTE)
+    if (length == OFFSET_START && data != START_BYTE) {
+      this->m_isSyncLost = this->m_idleFraming && this->m_timeout;
       continue;
+    }
     if (length == OFFSET_LENGTH && data <= OFFSET_DATA) {
-      this->m_data.clear();
+      this->m_discard();
       continue;
     }
     this->m_data.push_back(data);
     if (length > OFFSET_DATA && length >= this->m_data[OFFSET_LENGTH]) {
       if (this->isValid())
         return true;
-      this->m_data.clear();
+      this->m_discard();
     }
   }
   return false;
 }
 
+TimerTick ApplianceBase::FrameReceiver::getNextDelay(TimerTick now) const {
+  if (!this->m_timeout || (this->m_data.empty() && !this->m_isSyncLost))
+    return TimerManager::NO_DEADLINE;
+  const TimerTick elapsed = now - this->m_lastByte;
+  return (elapsed < this->m_timeout) ? this->m_timeout - elapsed : 0;
+}
+
+void ApplianceBase::FrameReceiver::m_discard() {
+  this->m_data.clear();
+  this->m_numDiscards.fetch_add(1, std::memory_order_relaxed);
+  // frame boundary is unknown: wait for idle line
+  this->m_isSyncLost = this->m_idleFraming && this->m_timeout;
+}
+
+ApplianceBase::~ApplianceBase() {
+  // handlers may refer to already destroyed derived appliance: only completions are resolved
+  if (this->m_request != nullptr) {
+    this->m_request->completion.m_complete(COMPLETION_DROPPED);
+    delete this->m_request;
+    this->m_request = nullptr;
+  }
+  for (uint8_t cls = 0; cls < NUM_REQUEST_CLASSES; ++cls) {
+    while (this->m_queue.size(cls)) {
+      Request *request = this->m_queue.pop(cls);
+      request->completion.m_complete(COMPLETION_DROPPED);
+      delete request;
+    }
+  }
+}
+
+void ApplianceBase::setBaudRate(uint32_t baudRate) {
+  // 10 bits per character: allow 10 character times plus 2 ms of UART FIFO latency
+  this->setInterByteTimeout((10UL * 10UL * 1000UL + baudRate - 1) / baudRate + 2);
+}
+
 void ApplianceBase::setup() {
+  this->m_queue.setAgingLimit(CLASS_QUERY, 10 * 1000);
+  this->m_queue.setAgingLimit(CLASS_NOTIFY, 30 * 1000);
+  this->m_queue.setAgingLimit(CLASS_BACKGROUND, 60 * 1000);
   this->m_timerManager.registerTimer(this->m_periodTimer);
   this->m_timerManager.registerTimer(this->m_networkTimer);
   this->m_timerManager.registerTimer(this->m_responseTimer);
   this->m_networkTimer.setCallback([this](Timer *timer) {
-    this->m_sendNetworkNotify();
+    // the only read of provider: QUERY_NETWORK answers use cached notification
+    this->m_refreshNetworkStatus();
+    if (this->isOnline())
+      this->m_sendNetworkNotify();
     timer->reset();
   });
   this->m_networkTimer.start(2 * 60 * 1000);
@@ -53,43 +118,298 @@ void ApplianceBase::setup() {
 }
 
 void ApplianceBase::loop() {
+#ifdef MIDEA_PROFILING
+  const uint32_t start = micros();
+  if (this->m_profile[PROFILE_LOOP].getCount())
+    this->m_profile[PROFILE_INTERVAL].add(start - this->m_loopStart);
+  this->m_loopStart = start;
+#endif
+  MIDEA_PROFILE(PROFILE_LOOP);
+  // Commands from other threads
+  m_processCommands();
   // Timers task
-  m_timerManager.task();
+  {
+    MIDEA_PROFILE(PROFILE_TIMERS);
+    m_timerManager.task();
+  }
   // Loop for appliances
   m_loop();
+  // Frame transmitting
+  if (this->m_isSending) {
+    MIDEA_PROFILE(PROFILE_TX);
+    this->m_writeFrame();
+  }
   // Frame receiving
-  while (this->m_receiver.read(this->m_stream)) {
-    this->m_protocol = this->m_receiver.getProtocol();
-    LOG_D(TAG, "RX: %s", this->m_receiver.toString().c_str());
-    this->m_handler(this->m_receiver);
-    this->m_receiver.clear();
+  if (this->m_rxRing != nullptr) {
+    for (const FrameSlot *slot; (slot = this->m_rxRing->front()) != nullptr;) {
+      {
+        MIDEA_PROFILE(PROFILE_RX);
+        this->m_rxFrame.assign(slot->data, slot->size);
+        this->m_rxRing->release();
+      }
+      MIDEA_PROFILE(PROFILE_HANDLER);
+      this->m_onFrame(this->m_rxFrame);
+    }
+    this->m_stats.rxOverruns = this->m_rxOverruns.load(std::memory_order_relaxed);
+  } else {
+    if (this->m_stream->available() > 0)
+      this->m_onRxActivity();
+    for (;;) {
+      {
+        MIDEA_PROFILE(PROFILE_RX);
+        if (!this->m_receiver.read(this->m_stream, this->m_timerManager.getClock()))
+          break;
+      }
+      {
+        MIDEA_PROFILE(PROFILE_HANDLER);
+        this->m_onFrame(this->m_receiver);
+      }
+      this->m_receiver.clear();
+    }
   }
-  if (this->m_isBusy || this->m_isWaitForResponse())
+  const uint32_t rxDiscards = this->m_receiver.getNumDiscards();
+  // corrupted frames of receive thread are activity too
+  if (rxDiscards != this->m_stats.rxDiscards)
+    this->m_onRxActivity();
+  this->m_stats.rxDiscards = rxDiscards;
+  if (this->m_isBusy)
+    return;
+  if (this->m_queue.size(CLASS_RESPONSE)) {
+    // responses don't wait for current request completion
+    Request *response = this->m_queue.pop(CLASS_RESPONSE);
+    LOG_D(TAG, "Sending a response from the queue...");
+    this->m_sendRequest(response);
+    response->completion.m_setSent();
+    response->completion.m_complete(COMPLETION_OK);
+    delete response;
     return;
-  if (this->m_queue.empty()) {
+  }
+  if (this->m_request != nullptr) {
+    if (this->m_isNextStep) {
+      LOG_D(TAG, "Sending next frame of the transaction...");
+      this->m_isNextStep = false;
+      this->m_sendStep();
+    }
+    return;
+  }
+  if (!this->isOnline() && this->m_timerManager.getTime() - this->m_probeTime < this->m_probeInterval)
+    return;
+  this->m_request = this->m_popRequest();
+  if (this->m_request == nullptr) {
     this->m_onIdle();
     return;
   }
-  this->m_request = this->m_queue.front();
-  this->m_queue.pop_front();
+  if (!this->isOnline()) {
+    LOG_D(TAG, "Sending a probe request...");
+    this->m_probeTime = this->m_timerManager.getTime();
+  }
   LOG_D(TAG, "Getting and sending a request from the queue...");
+  this->m_sendStep();
+}
+
+TimerTick ApplianceBase::m_getNextDelay(TimerTick now) const {
+  // received frames are handled in next loop
+  if (this->m_rxRing != nullptr ? this->m_rxRing->front() != nullptr
+                                 : (this->m_stream != nullptr && this->m_stream->available() > 0))
+    return 0;
+  TimerTick delay = this->m_timerManager.getNextDelay(now);
+  // receiver is owned by receive thread in that mode
+  if (this->m_rxRing == nullptr)
+    delay = std::min(delay, this->m_receiver.getNextDelay(now));
+  // UART drains TX buffer with time
+  if (this->m_isSending)
+    delay = std::min<TimerTick>(delay, 1);
+  if (this->m_isBusy)
+    return delay;
+  if (this->m_queue.size(CLASS_RESPONSE) || (this->m_request != nullptr && this->m_isNextStep))
+    return 0;
+  if (this->m_request != nullptr)
+    return delay;
+  if (this->isOnline())
+    return this->m_queue.empty() ? delay : 0;
+  // next probe request: with empty queue idle callback may queue it
+  const TimerTick elapsed = now - this->m_probeTime;
+  return std::min(delay, (elapsed < this->m_probeInterval) ? this->m_probeInterval - elapsed : 0);
+}
+
+bool ApplianceBase::getNextDeadline(TimerTick &deadline) const {
+  const TimerTick now = this->m_timerManager.now();
+  const TimerTick delay = this->m_getNextDelay(now);
+  if (delay == TimerManager::NO_DEADLINE)
+    return false;
+  deadline = now + delay;
+  return true;
+}
+
+void ApplianceBase::setClock(Clock *clock) {
+  const TimerTick delta = this->m_timerManager.setClock(clock);
+  this->m_queue.rebase(delta);
+  this->m_probeTime += delta;
+  this->m_requestTxTime += delta;
+}
+
+bool ApplianceBase::run(uint32_t duration, const std::function<bool()> &done) {
+  Clock &clock = this->m_timerManager.getClock();
+  const TimerTick start = clock.now();
+  for (;;) {
+    this->loop();
+    if (done != nullptr && done())
+      return true;
+    const TimerTick now = clock.now();
+    const TimerTick elapsed = now - start;
+    if (elapsed >= duration)
+      return false;
+    clock.idle(std::min<TimerTick>(this->m_getNextDelay(now), duration - elapsed));
+  }
+}
+
+ApplianceBase::Request *ApplianceBase::m_popRequest() {
+  const TimerTick now = this->m_timerManager.getTime();
+  while (!this->m_queue.empty()) {
+    const uint8_t cls = this->m_queue.next(now);
+    const TimerTick queued = this->m_queue.queue(cls).front().time;
+    Request *request = this->m_queue.pop(cls);
+    if (!request->lifetime || now - queued < request->lifetime)
+      return request;
+    LOG_D(TAG, "Dropping the expired request...");
+    this->m_dropRequest(request, COMPLETION_EXPIRED);
+  }
+  return nullptr;
+}
+
+void ApplianceBase::m_sendStep() {
   this->m_sendRequest(this->m_request);
+  this->m_request->completion.m_setSent();
   if (this->m_request->onData != nullptr) {
+    this->m_isRttSample = true;
     this->m_resetAttempts();
     this->m_resetTimeout();
-  } else {    
-    this->m_destroyRequest();
+  } else {
+    this->m_completeStep();
   }
 }
 
+void ApplianceBase::m_completeStep() {
+  if (this->m_request->advance()) {
+    // next frame will be sent after request period
+    this->m_responseTimer.stop();
+    this->m_isNextStep = true;
+    return;
+  }
+  ++this->m_stats.completed;
+  if (this->m_request->onSuccess != nullptr)
+    this->m_request->onSuccess();
+  this->m_request->completion.m_complete(COMPLETION_OK);
+  this->m_destroyRequest();
+}
+
+void ApplianceBase::m_onFrame(const Frame &frame) {
+  this->m_protocol = frame.getProtocol();
+  ++this->m_stats.rxFrames;
+  LOG_D(TAG, "RX: %s", frame.toString().c_str());
+  this->m_trace(TRACE_RX, frame);
+  this->m_numFailures = 0;
+  this->m_setAvailability(AVAILABILITY_ONLINE);
+  this->m_handler(frame);
+}
+
+void ApplianceBase::m_onRequestFailed() {
+  if (this->m_numFailures < UINT8_MAX)
+    ++this->m_numFailures;
+  if (this->m_availability == AVAILABILITY_OFFLINE) {
+    this->m_probeInterval = std::min(this->m_probeInterval * 2, this->m_maxProbeInterval);
+    LOG_D(TAG, "Probe failed. Next probe in %" PRIu32 " ms.", this->m_probeInterval);
+  } else if (this->m_numFailures >= this->m_offlineThreshold) {
+    this->m_probeInterval = this->m_minProbeInterval;
+    this->m_probeTime = this->m_timerManager.getTime();
+    this->m_setAvailability(AVAILABILITY_OFFLINE);
+  } else {
+    this->m_setAvailability(AVAILABILITY_DEGRADED);
+  }
+}
+
+void ApplianceBase::m_onRxActivity() {
+  // valid frames switch to online in `m_onFrame()`, any other traffic cancels probe backoff
+  if (this->isOnline() || this->m_probeInterval <= this->m_minProbeInterval)
+    return;
+  LOG_D(TAG, "RX activity while offline. Probing now...");
+  this->m_probeInterval = this->m_minProbeInterval;
+  this->m_probeTime = this->m_timerManager.getTime() - this->m_probeInterval;
+}
+
+void ApplianceBase::m_setAvailability(Availability value) {
+  if (this->m_availability == value)
+    return;
+  static const char *const NAMES[] = {"ONLINE", "DEGRADED", "OFFLINE"};
+  LOG_I(TAG, "Appliance is %s.", NAMES[value]);
+  this->m_availability = value;
+  for (auto &cb : this->m_availabilityCallbacks)
+    cb(value);
+}
+
+#ifdef MIDEA_PROFILING
+void ApplianceBase::resetProfile() {
+  for (DurationStats &stats : this->m_profile)
+    stats.reset();
+}
+
+void ApplianceBase::dumpProfile() const {
+  static const char *const NAMES[] = {"LOOP", "INTERVAL", "TIMERS", "RX", "HANDLER", "CALLBACKS", "TX"};
+  LOG_I(TAG, "LOOP PROFILE (us):");
+  for (uint8_t idx = 0; idx < NUM_PROFILE_PHASES; ++idx) {
+    const DurationStats &stats = this->m_profile[idx];
+    LOG_I(TAG, "  %-9s count: %" PRIu32 ", min: %" PRIu32 ", avg: %" PRIu32 ", p99: %" PRIu32 ", max: %" PRIu32, NAMES[idx], stats.getCount(),
+          stats.getMin(), stats.getAverage(), stats.getPercentile(99), stats.getMax());
+  }
+}
+#endif
+
+void ApplianceBase::setRxThreadMode(bool value) {
+  if (value && this->m_rxRing == nullptr)
+    this->m_rxRing.reset(new RxRing());
+  else if (!value)
+    this->m_rxRing.reset();
+}
+
+void ApplianceBase::rxTask() {
+  while (this->m_receiver.read(this->m_stream, this->m_timerManager.getClock())) {
+    FrameSlot *slot = this->m_rxRing->acquire();
+    if (slot != nullptr) {
+      slot->size = this->m_receiver.size();
+      memcpy(slot->data, this->m_receiver.data(), slot->size);
+      this->m_rxRing->commit();
+    } else {
+      this->m_rxOverruns.fetch_add(1, std::memory_order_relaxed);
+    }
+    this->m_receiver.clear();
+  }
+}
+
+#ifdef ARDUINO_ARCH_ESP32
+static void rxTaskFn(void *arg) {
+  auto appliance = static_cast<ApplianceBase *>(arg);
+  for (;;) {
+    appliance->rxTask();
+    vTaskDelay(1);
+  }
+}
+
+bool ApplianceBase::startRxTask(uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+  this->setRxThreadMode(true);
+  return xTaskCreatePinnedToCore(rxTaskFn, "midea_rx", stackSize, this, priority, nullptr, core) == pdPASS;
+}
+#endif
+
 void ApplianceBase::m_handler(const Frame &frame) {
   if (this->m_isWaitForResponse()) {
     auto result = this->m_request->callHandler(frame);
     if (result != RESPONSE_WRONG) {
+      if (this->m_isRttSample) {
+        this->m_isRttSample = false;
+        this->m_rtt.addSample(this->m_timerManager.now() - this->m_requestTxTime);
+      }
       if (result == RESPONSE_OK) {
-        if (this->m_request->onSuccess != nullptr)
-          this->m_request->onSuccess();
-        this->m_destroyRequest();
+        this->m_completeStep();
       } else {
         this->m_resetAttempts();
         this->m_resetTimeout();
@@ -108,46 +428,55 @@ void ApplianceBase::m_handler(const Frame &frame) {
   this->m_onRequest(frame);
 }
 
-static uint8_t getSignalStrength() {
-  const int32_t dbm = WiFi.RSSI();
-  if (dbm > -63)
-    return 4;
-  if (dbm > -75)
-    return 3;
-  if (dbm > -88)
-    return 2;
-  return 1;
+void ApplianceBase::m_refreshNetworkStatus() {
+  NetworkStatus status{};
+  if (this->m_networkProvider != nullptr)
+    this->m_networkProvider->getStatus(status);
+  NetworkNotifyData notify{};
+  notify.setConnected(status.connected);
+  notify.setSignalStrength(status.signalStrength);
+  notify.setIP(status.ip);
+  notify.appendCRC();
+  this->m_networkNotify = std::move(notify);
 }
 
 void ApplianceBase::m_sendNetworkNotify(FrameType msgType) {
-  NetworkNotifyData notify{};
-  notify.setConnected(WiFi.isConnected());
-  notify.setSignalStrength(getSignalStrength());
-  notify.setIP(WiFi.localIP());
-  notify.appendCRC();
   if (msgType == NETWORK_NOTIFY) {
     LOG_D(TAG, "Enqueuing a DEVICE_NETWORK(0x0D) notification...");
-    this->m_queueNotify(msgType, std::move(notify));
+    // stale after next notification
+    this->m_queueRequest(CLASS_NOTIFY, msgType, this->m_networkNotify, nullptr, nullptr, nullptr, 2 * 60 * 1000);
   } else {
-    LOG_D(TAG, "Answer to QUERY_NETWORK(0x63) request...");
-    this->m_sendFrame(msgType, std::move(notify));
+    LOG_D(TAG, "Enqueuing an answer to QUERY_NETWORK(0x63) request...");
+    this->m_queueRequest(CLASS_RESPONSE, msgType, this->m_networkNotify);
   }
 }
 
 void ApplianceBase::m_resetTimeout() {
   this->m_responseTimer.setCallback([this](Timer *timer) {
+    // still transmitting: timeout is counted from the end of transmission
+    if (this->m_isSending) {
+      timer->reset();
+      return;
+    }
     LOG_D(TAG, "Response timeout...");
     if (!--this->m_remainAttempts) {
+      ++this->m_stats.failed;
+      this->m_onRequestFailed();
       if (this->m_request->onError != nullptr)
         this->m_request->onError();
+      this->m_request->completion.m_complete(COMPLETION_ERROR);
       this->m_destroyRequest();
       return;
     }
     LOG_D(TAG, "Sending request again. Attempts left: %d...", this->m_remainAttempts);
+    ++this->m_stats.retries;
+    // Karn's algorithm: response to repeated request is ambiguous
+    this->m_isRttSample = false;
+    this->m_rtt.backoff();
     this->m_sendRequest(this->m_request);
     this->m_resetTimeout();
   });
-  this->m_responseTimer.start(this->m_timeout);
+  this->m_responseTimer.start(this->m_adaptiveTimeout ? this->m_rtt.getTimeout() : this->m_timeout);
 }
 
 void ApplianceBase::m_destroyRequest() {
@@ -155,28 +484,144 @@ void ApplianceBase::m_destroyRequest() {
   this->m_responseTimer.stop();
   delete this->m_request;
   this->m_request = nullptr;
+  this->m_isNextStep = false;
 }
 
 void ApplianceBase::m_sendFrame(FrameType type, const FrameData &data) {
+  MIDEA_PROFILE(PROFILE_TX);
   Frame frame(this->m_appType, this->m_protocol, type, data);
   LOG_D(TAG, "TX: %s", frame.toString().c_str());
-  this->m_stream->write(frame.data(), frame.size());
+  this->m_trace(TRACE_TX, frame);
+  ++this->m_stats.txFrames;
   this->m_isBusy = true;
+  // period timer is started after last byte is written
+  this->m_periodTimer.stop();
+  if (!this->m_nonBlockingWrite) {
+    this->m_stream->write(frame.data(), frame.size());
+    this->m_onFrameSent();
+    return;
+  }
+  this->m_txFrame = std::move(frame);
+  this->m_txOffset = 0;
+  this->m_isSending = true;
+  this->m_writeFrame();
+}
+
+void ApplianceBase::m_writeFrame() {
+  const int available = this->m_stream->availableForWrite();
+  if (available <= 0)
+    return;
+  const size_t size = std::min<size_t>(available, this->m_txFrame.size() - this->m_txOffset);
+  this->m_txOffset += this->m_stream->write(this->m_txFrame.data() + this->m_txOffset, size);
+  if (this->m_txOffset < this->m_txFrame.size())
+    return;
+  this->m_isSending = false;
+  this->m_onFrameSent();
+}
+
+void ApplianceBase::m_onFrameSent() {
   this->m_periodTimer.setCallback([this](Timer *timer) {
     this->m_isBusy = false;
     timer->stop();
   });
   this->m_periodTimer.start(this->m_period);
+  // responses sent while waiting must not affect RTT samples and response timeout
+  if (!this->m_isRequestFrame)
+    return;
+  this->m_requestTxTime = this->m_timerManager.now();
+  // response timeout is counted from the end of transmission
+  if (this->m_responseTimer.isEnabled())
+    this->m_responseTimer.reset();
+}
+
+void ApplianceBase::m_trace(TraceDirection direction, const Frame &frame) {
+  if (this->m_traceSink == nullptr)
+    return;
+  const TraceRecord record{static_cast<uint32_t>(this->m_timerManager.now()), direction, frame.size()};
+  this->m_traceSink->write(record, frame.data());
+}
+
+Completion ApplianceBase::m_queueRequest(RequestClass cls, FrameType type, FrameData data, ResponseHandler onData, Handler onSucess, Handler onError, uint32_t lifetime) {
+  LOG_D(TAG, "Enqueuing the request of class %d...", cls);
+  auto request = new Request{std::move(data), std::move(onData), std::move(onSucess), std::move(onError), type, Completion(this), {}, 0, lifetime};
+  Completion completion = request->completion;
+  this->m_enqueue(cls, request);
+  return completion;
+}
+
+Completion ApplianceBase::m_queueTransaction(RequestClass cls, Transaction transaction, Handler onSuccess, Handler onError, uint32_t lifetime) {
+  if (transaction.empty())
+    return Completion::resolved(COMPLETION_REJECTED);
+  LOG_D(TAG, "Enqueuing the transaction of %d frames...", static_cast<int>(transaction.size()));
+  Transaction::Step &first = transaction.m_steps.front();
+  auto request = new Request{std::move(first.data), std::move(first.onData), std::move(onSuccess), std::move(onError), first.type, Completion(this),
+                             std::move(transaction.m_steps), 1, lifetime};
+  Completion completion = request->completion;
+  this->m_enqueue(cls, request);
+  return completion;
 }
 
-void ApplianceBase::m_queueRequest(FrameType type, FrameData data, ResponseHandler onData, Handler onSucess, Handler onError) {
-  LOG_D(TAG, "Enqueuing the request...");
-  this->m_queue.push_back(new Request{std::move(data), std::move(onData), std::move(onSucess), std::move(onError), type});
+bool ApplianceBase::m_enqueue(RequestClass cls, Request *request) {
+  // loop: callbacks of dropped request may enqueue new ones.
+  // Responses are exempt: appliance must get its answer.
+  while (cls != CLASS_RESPONSE && this->m_queueCapacity && this->m_queue.size() >= this->m_queueCapacity) {
+    if (this->m_makeRoom(cls, request))
+      continue;
+    LOG_W(TAG, "Request queue is full. Request rejected.");
+    ++this->m_stats.rejected;
+    if (request->onError != nullptr)
+      request->onError();
+    request->completion.m_complete(COMPLETION_REJECTED);
+    delete request;
+    return false;
+  }
+  this->m_queue.push(cls, request, this->m_timerManager.getTime());
+  const size_t size = this->m_queue.size();
+  if (size > this->m_stats.queueHighWater)
+    this->m_stats.queueHighWater = size;
+  return true;
+}
+
+static bool isSameKind(const FrameData &a, const FrameData &b) {
+  const size_t size = std::min<size_t>(a.size(), 2);
+  return size == std::min<size_t>(b.size(), 2) && std::equal(a.data(), a.data() + size, b.data());
+}
+
+bool ApplianceBase::m_makeRoom(RequestClass cls, const Request *request) {
+  auto &queue = this->m_queue.queue(cls);
+  if (queue.empty())
+    return false;
+  if (this->m_overflowPolicy == OVERFLOW_DROP_OLDEST) {
+    LOG_W(TAG, "Request queue is full. Dropping the oldest request...");
+    // remove before notifying: callback may enqueue new requests
+    Request *oldest = queue.front().item;
+    queue.pop_front();
+    this->m_dropRequest(oldest, COMPLETION_DROPPED);
+    return true;
+  }
+  if (this->m_overflowPolicy != OVERFLOW_REPLACE)
+    return false;
+  for (auto it = queue.begin(); it != queue.end(); ++it) {
+    Request *queued = it->item;
+    if (queued->requestType == request->requestType && isSameKind(queued->request, request->request)) {
+      LOG_D(TAG, "Request queue is full. Replacing the request of the same kind...");
+      queue.erase(it);
+      this->m_dropRequest(queued, COMPLETION_DROPPED);
+      return true;
+    }
+  }
+  return false;
 }
 
-void ApplianceBase::m_queueRequestPriority(FrameType type, FrameData data, ResponseHandler onData, Handler onSucess, Handler onError) {
-  LOG_D(TAG, "Priority request queuing...");
-  this->m_queue.push_front(new Request{std::move(data), std::move(onData), std::move(onSucess), std::move(onError), type});
+void ApplianceBase::m_dropRequest(Request *request, CompletionStatus status) {
+  if (status == COMPLETION_DROPPED)
+    ++this->m_stats.dropped;
+  else
+    ++this->m_stats.expired;
+  if (request->onError != nullptr)
+    request->onError();
+  request->completion.m_complete(status);
+  delete request;
 }
 
 void ApplianceBase::setBeeper(bool value) {
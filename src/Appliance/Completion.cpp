@@ -0,0 +1,52 @@
+#include "Appliance/Completion.h"
+#include "Appliance/ApplianceBase.h"
+
+namespace dudanov {
+namespace midea {
+
+Completion::Completion(ApplianceBase *appliance)
+  : m_state(std::make_shared<State>(State{appliance, nullptr, 0, 0, COMPLETION_PENDING, false})) {}
+
+Completion Completion::resolved(CompletionStatus status) {
+  Completion completion(nullptr);
+  completion.m_state->status = status;
+  return completion;
+}
+
+void Completion::then(CompletionCallback cb) {
+  if (!this->m_state || this->isDone())
+    cb(*this);
+  else
+    this->m_state->callback = std::move(cb);
+}
+
+bool Completion::wait(uint32_t timeout) const {
+  if (this->isDone())
+    return true;
+  return this->m_state->appliance->run(timeout, [this]() { return this->isDone(); });
+}
+
+void Completion::m_setSent() {
+  if (!this->m_state || this->m_state->isSent)
+    return;
+  this->m_state->isSent = true;
+  this->m_state->sent = this->m_state->appliance->getClock().now();
+}
+
+void Completion::m_complete(CompletionStatus status) {
+  if (!this->m_state || this->isDone())
+    return;
+  State &state = *this->m_state;
+  state.status = status;
+  if (state.isSent)
+    state.latency = state.appliance->getClock().now() - state.sent;
+  if (state.callback == nullptr)
+    return;
+  // callback may hold the last reference to its own captures
+  CompletionCallback cb = std::move(state.callback);
+  state.callback = nullptr;
+  cb(*this);
+}
+
+}  // namespace midea
+}  // namespace dudanov
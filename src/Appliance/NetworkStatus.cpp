@@ -0,0 +1,38 @@
+#include "Appliance/NetworkStatus.h"
+#if defined(ARDUINO_ARCH_ESP32)
+#include <WiFi.h>
+#elif defined(ARDUINO_ARCH_ESP8266)
+#include <ESP8266WiFi.h>
+#endif
+
+namespace dudanov {
+namespace midea {
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+static uint8_t getSignalStrength() {
+  const int32_t dbm = WiFi.RSSI();
+  if (dbm > -63)
+    return 4;
+  if (dbm > -75)
+    return 3;
+  if (dbm > -88)
+    return 2;
+  return 1;
+}
+
+void WiFiNetworkStatus::getStatus(NetworkStatus &status) {
+  const IPAddress ip = WiFi.localIP();
+  status.connected = WiFi.isConnected();
+  status.signalStrength = getSignalStrength();
+  for (uint8_t idx = 0; idx < 4; ++idx)
+    status.ip[idx] = ip[idx];
+}
+
+WiFiNetworkStatus *WiFiNetworkStatus::instance() {
+  static WiFiNetworkStatus provider;
+  return &provider;
+}
+#endif
+
+}  // namespace midea
+}  // namespace dudanov
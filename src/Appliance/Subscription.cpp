@@ -0,0 +1,66 @@
+#include "Appliance/Subscription.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace dudanov {
+namespace midea {
+
+SubscriptionOptions &SubscriptionOptions::setDeadband(uint16_t field, float deadband) {
+  for (uint8_t idx = 0; idx < MAX_FIELDS; ++idx)
+    if (field & (1 << idx))
+      this->deadbands[idx] = deadband;
+  return *this;
+}
+
+void SubscriptionList::add(const SubscriptionOptions &options, OnChangeCallback cb) {
+  // callbacks may subscribe: list must not grow under running callback
+  auto &items = this->m_isUpdating ? this->m_added : this->m_items;
+  items.push_back(Subscription{options, std::move(cb), {}, 0, false, false});
+}
+
+void SubscriptionList::update(const float *values, uint8_t numFields, TimerTick now) {
+  this->m_isPending = false;
+  this->m_isUpdating = true;
+  for (Subscription &sub : this->m_items) {
+    uint16_t changed = 0;
+    sub.isPending = false;
+    for (uint8_t idx = 0; idx < numFields; ++idx) {
+      const uint16_t mask = 1 << idx;
+      if (!(sub.options.fields & mask))
+        continue;
+      // values are compared with last delivered, so slow drift is delivered too
+      if (!sub.hasValues || std::fabs(values[idx] - sub.values[idx]) > sub.options.deadbands[idx])
+        changed |= mask;
+    }
+    if (!changed)
+      continue;
+    if (sub.hasValues && now - sub.time < sub.options.minInterval) {
+      this->m_isPending = sub.isPending = true;
+      continue;
+    }
+    for (uint8_t idx = 0; idx < numFields; ++idx)
+      if (changed & (1 << idx))
+        sub.values[idx] = values[idx];
+    sub.time = now;
+    sub.hasValues = true;
+    sub.cb(changed);
+  }
+  this->m_isUpdating = false;
+  std::move(this->m_added.begin(), this->m_added.end(), std::back_inserter(this->m_items));
+  this->m_added.clear();
+}
+
+TimerTick SubscriptionList::getNextDelay(TimerTick now) const {
+  TimerTick delay = TimerManager::NO_DEADLINE;
+  for (const Subscription &sub : this->m_items) {
+    if (!sub.isPending)
+      continue;
+    const TimerTick elapsed = now - sub.time;
+    delay = std::min<TimerTick>(delay, (elapsed < sub.options.minInterval) ? sub.options.minInterval - elapsed : 0);
+  }
+  return delay;
+}
+
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,96 @@
+#include "Appliance/TraceReplay.h"
+#include "Helpers/Log.h"
+#include <cinttypes>
+
+namespace dudanov {
+namespace midea {
+
+static const char *TAG = "TraceReplay";
+
+void TraceReplay::begin(ApplianceBase *appliance) {
+  this->m_appliance = appliance;
+  this->m_rxSize = this->m_rxPos = this->m_txSize = 0;
+  this->m_numRecords = this->m_numMismatches = 0;
+  appliance->setStream(this);
+  // virtual clock starts at the time of first record
+  this->m_hasRecord = this->m_source->read(this->m_next, this->m_record);
+  this->m_traceStart = this->m_hasRecord ? this->m_next.timestamp : 0;
+  this->m_clock.set(this->m_traceStart);
+  appliance->setClock(&this->m_clock);
+  this->m_wallStart = ::millis();
+}
+
+void TraceReplay::end() {
+  if (this->m_appliance != nullptr)
+    this->m_appliance->setClock(nullptr);
+  this->m_appliance = nullptr;
+}
+
+bool TraceReplay::step() {
+  if (this->m_appliance == nullptr || !this->m_hasRecord)
+    return false;
+  const TraceRecord record = this->m_next;
+  ++this->m_numRecords;
+  this->m_advance(record.timestamp);
+  if (record.direction == TRACE_RX) {
+    memcpy(this->m_rx, this->m_record, record.size);
+    this->m_rxSize = record.size;
+    this->m_rxPos = 0;
+    this->m_appliance->loop();
+  } else {
+    this->m_appliance->loop();
+    this->m_checkTx(record.size);
+  }
+  this->m_hasRecord = this->m_source->read(this->m_next, this->m_record);
+  return true;
+}
+
+void TraceReplay::m_advance(uint32_t time) {
+  for (uint32_t clock; static_cast<int32_t>(time - (clock = this->m_clock.now())) > 0;) {
+    if (this->m_realTime) {
+      const uint32_t now = this->m_traceStart + (::millis() - this->m_wallStart);
+      if (static_cast<int32_t>(now - clock) <= 0) {
+        yield();
+        continue;
+      }
+      this->m_clock.set((static_cast<int32_t>(time - now) > 0) ? now : time);
+    } else {
+      // jump to next deadline of appliance, so timers fire at the same times as on real hardware
+      TimerTick deadline;
+      if (!this->m_appliance->getNextDeadline(deadline) || static_cast<int32_t>(deadline - time) > 0)
+        deadline = time;
+      else if (static_cast<int32_t>(deadline - clock) <= 0)
+        deadline = clock + 1;
+      this->m_clock.set(deadline);
+    }
+    this->m_appliance->loop();
+  }
+}
+
+void TraceReplay::m_checkTx(uint8_t size) {
+  if (this->m_txSize < size || memcmp(this->m_tx, this->m_record, size)) {
+    LOG_W(TAG, "TX mismatch at %" PRIu32 " ms.", this->getTime());
+    ++this->m_numMismatches;
+    this->m_txSize = 0;
+    return;
+  }
+  this->m_txSize -= size;
+  memmove(this->m_tx, this->m_tx + size, this->m_txSize);
+}
+
+size_t TraceReplay::write(uint8_t data) {
+  if (this->m_txSize >= sizeof(this->m_tx))
+    return 0;
+  this->m_tx[this->m_txSize++] = data;
+  return 1;
+}
+
+size_t TraceReplay::write(const uint8_t *data, size_t size) {
+  size_t n = 0;
+  while (n < size && this->write(data[n]))
+    ++n;
+  return n;
+}
+
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,39 @@
+#include "Frame/FrameTrace.h"
+
+namespace dudanov {
+namespace midea {
+
+void TraceRecord::encode(uint8_t *dst) const {
+  dst[0] = this->timestamp;
+  dst[1] = this->timestamp >> 8;
+  dst[2] = this->timestamp >> 16;
+  dst[3] = this->timestamp >> 24;
+  dst[4] = this->direction;
+  dst[5] = this->size;
+}
+
+bool TraceRecord::decode(const uint8_t *src) {
+  if (src[4] > TRACE_TX)
+    return false;
+  this->timestamp = src[0] | (src[1] << 8) | (src[2] << 16) | (static_cast<uint32_t>(src[3]) << 24);
+  this->direction = static_cast<TraceDirection>(src[4]);
+  this->size = src[5];
+  return true;
+}
+
+void StreamTraceSink::write(const TraceRecord &record, const uint8_t *data) {
+  uint8_t header[TraceRecord::HEADER_SIZE];
+  record.encode(header);
+  this->m_out->write(header, sizeof(header));
+  this->m_out->write(data, record.size);
+}
+
+bool StreamTraceSource::read(TraceRecord &record, uint8_t *data) {
+  uint8_t header[TraceRecord::HEADER_SIZE];
+  if (this->m_in->readBytes(header, sizeof(header)) != sizeof(header) || !record.decode(header))
+    return false;
+  return this->m_in->readBytes(data, record.size) == record.size;
+}
+
+}  // namespace midea
+}  // namespace dudanov
@@ -0,0 +1,15 @@
+#include <Arduino.h>
+#include "Helpers/Clock.h"
+
+namespace dudanov {
+
+TimerTick ArduinoClock::now() const { return ::millis(); }
+
+void ArduinoClock::idle(TimerTick) { yield(); }
+
+ArduinoClock &ArduinoClock::instance() {
+  static ArduinoClock clock;
+  return clock;
+}
+
+}  // namespace dudanov
@@ -0,0 +1,43 @@
+#include "Helpers/DurationStats.h"
+
+namespace dudanov {
+
+static uint8_t bucketOf(uint32_t duration) {
+  uint8_t idx = 0;
+  for (; duration && idx < DurationStats::NUM_BUCKETS - 1; duration >>= 1)
+    ++idx;
+  return idx;
+}
+
+void DurationStats::add(uint32_t duration) {
+  ++this->m_count;
+  this->m_sum += duration;
+  if (duration < this->m_min)
+    this->m_min = duration;
+  if (duration > this->m_max)
+    this->m_max = duration;
+  ++this->m_buckets[bucketOf(duration)];
+}
+
+uint32_t DurationStats::getPercentile(uint8_t percent) const {
+  if (!this->m_count)
+    return 0;
+  // rank of percentile, rounded up
+  const uint64_t rank = (static_cast<uint64_t>(this->m_count) * percent + 99) / 100;
+  uint64_t sum = 0;
+  for (uint8_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+    sum += this->m_buckets[idx];
+    if (sum < rank || !sum)
+      continue;
+    // upper bound of bucket, limited by observed range
+    if (idx == NUM_BUCKETS - 1)
+      return this->m_max;
+    const uint32_t bound = idx ? (1UL << idx) - 1 : 0;
+    if (bound < this->m_min)
+      return this->m_min;
+    return (bound < this->m_max) ? bound : this->m_max;
+  }
+  return this->m_max;
+}
+
+}  // namespace dudanov
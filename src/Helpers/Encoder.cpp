@@ -0,0 +1,139 @@
+#include "Helpers/Encoder.h"
+#include <cmath>
+#include <cstring>
+
+namespace dudanov {
+
+void JsonEncoder::beginMap(size_t) {
+  this->m_put('{');
+  this->m_isFirst = true;
+}
+
+void JsonEncoder::endMap() {
+  this->m_put('}');
+  this->m_isFirst = false;
+}
+
+void JsonEncoder::key(const char *key) {
+  if (!this->m_isFirst)
+    this->m_put(',');
+  this->m_isFirst = false;
+  this->m_putString(key);
+  this->m_put(':');
+}
+
+void JsonEncoder::value(bool value) {
+  if (value)
+    this->m_put("true", 4);
+  else
+    this->m_put("false", 5);
+}
+
+void JsonEncoder::value(int32_t value) {
+  if (value < 0) {
+    this->m_put('-');
+    this->m_putInteger(-static_cast<uint32_t>(value));
+  } else {
+    this->m_putInteger(value);
+  }
+}
+
+void JsonEncoder::value(float value) {
+  const float magnitude = std::fabs(value);
+  // out of integer path range too
+  if (!std::isfinite(value) || magnitude >= 4294967296.0F) {
+    this->m_put("null", 4);
+    return;
+  }
+  // scaled by 100 must fit in 32 bits, larger floats have no fraction digits anyway
+  if (magnitude >= 40000000.0F) {
+    if (value < 0)
+      this->m_put('-');
+    this->m_putInteger(static_cast<uint32_t>(magnitude));
+    return;
+  }
+  const uint32_t scaled = static_cast<uint32_t>(magnitude * 100.0F + 0.5F);
+  if (value < 0 && scaled)
+    this->m_put('-');
+  this->m_putInteger(scaled / 100);
+  uint32_t frac = scaled % 100;
+  if (!frac)
+    return;
+  this->m_put('.');
+  this->m_put('0' + frac / 10);
+  if (frac % 10)
+    this->m_put('0' + frac % 10);
+}
+
+void JsonEncoder::value(const char *value) { this->m_putString(value); }
+
+void JsonEncoder::m_putString(const char *str) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  this->m_put('"');
+  for (; *str; ++str) {
+    const uint8_t ch = *str;
+    if (ch == '"' || ch == '\\') {
+      this->m_put('\\');
+      this->m_put(ch);
+    } else if (ch < 0x20) {
+      this->m_put("\\u00", 4);
+      this->m_put(HEX_DIGITS[ch >> 4]);
+      this->m_put(HEX_DIGITS[ch & 15]);
+    } else {
+      this->m_put(ch);
+    }
+  }
+  this->m_put('"');
+}
+
+void JsonEncoder::m_putInteger(uint32_t value) {
+  char digits[10];
+  uint8_t num = 0;
+  do {
+    digits[num++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (num)
+    this->m_put(digits[--num]);
+}
+
+void CborEncoder::value(int32_t value) {
+  if (value < 0)
+    this->m_putHead(1, static_cast<uint32_t>(-(value + 1)));
+  else
+    this->m_putHead(0, value);
+}
+
+void CborEncoder::value(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  this->m_put(0xFA);
+  for (int8_t shift = 24; shift >= 0; shift -= 8)
+    this->m_put(bits >> shift);
+}
+
+void CborEncoder::value(const char *value) {
+  const size_t size = strlen(value);
+  this->m_putHead(3, size);
+  this->m_put(value, size);
+}
+
+void CborEncoder::m_putHead(uint8_t major, uint32_t value) {
+  major <<= 5;
+  if (value < 24) {
+    this->m_put(major | value);
+  } else if (value <= UINT8_MAX) {
+    this->m_put(major | 24);
+    this->m_put(value);
+  } else if (value <= UINT16_MAX) {
+    this->m_put(major | 25);
+    this->m_put(value >> 8);
+    this->m_put(value);
+  } else {
+    this->m_put(major | 26);
+    for (int8_t shift = 24; shift >= 0; shift -= 8)
+      this->m_put(value >> shift);
+  }
+}
+
+}  // namespace dudanov
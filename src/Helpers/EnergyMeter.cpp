@@ -0,0 +1,88 @@
+#include "Helpers/EnergyMeter.h"
+
+namespace dudanov {
+
+static void addSaturated(uint32_t &acc, uint32_t value) { acc = (value < UINT32_MAX - acc) ? acc + value : UINT32_MAX; }
+
+uint32_t EnergyMeter::update(uint32_t counter, uint32_t time) {
+  counter %= this->m_modulo;
+  if (!this->m_hasReading) {
+    this->m_hasReading = true;
+    this->m_counter = counter;
+    this->m_time = time;
+    return 0;
+  }
+  this->m_advance(time);
+  uint32_t delta;
+  if (counter >= this->m_counter) {
+    delta = counter - this->m_counter;
+  } else if (this->m_counter - counter > this->m_modulo / 2) {
+    // counter overflow
+    ++this->m_numWraps;
+    delta = counter + this->m_modulo - this->m_counter;
+  } else {
+    // counter was cleared: all its value is new energy
+    ++this->m_numResets;
+    delta = counter;
+  }
+  this->m_counter = counter;
+  // scaled in 64 bits: large counter jump must not wrap
+  const uint64_t energy = static_cast<uint64_t>(delta) * this->m_resolution;
+  this->m_total += energy;
+  const uint32_t value = (energy < UINT32_MAX) ? static_cast<uint32_t>(energy) : UINT32_MAX;
+  addSaturated(this->m_hours[this->m_hour], value);
+  addSaturated(this->m_days[this->m_day], value);
+  return value;
+}
+
+void EnergyMeter::reset() {
+  for (uint32_t &hour : this->m_hours)
+    hour = 0;
+  for (uint32_t &day : this->m_days)
+    day = 0;
+  this->m_total = 0;
+  this->m_hourPhase = 0;
+  this->m_numResets = this->m_numWraps = 0;
+  this->m_hour = this->m_day = this->m_hourOfDay = 0;
+  this->m_hasReading = false;
+}
+
+uint32_t EnergyMeter::getHour(uint8_t idx) const {
+  if (idx >= MIDEA_ENERGY_METER_HOURS)
+    return 0;
+  return this->m_hours[(this->m_hour + MIDEA_ENERGY_METER_HOURS - idx) % MIDEA_ENERGY_METER_HOURS];
+}
+
+uint32_t EnergyMeter::getDay(uint8_t idx) const {
+  if (idx >= MIDEA_ENERGY_METER_DAYS)
+    return 0;
+  return this->m_days[(this->m_day + MIDEA_ENERGY_METER_DAYS - idx) % MIDEA_ENERGY_METER_DAYS];
+}
+
+uint32_t EnergyMeter::getLastHours(uint8_t hours) const {
+  uint32_t sum = 0;
+  for (uint8_t idx = 0; idx < hours && idx < MIDEA_ENERGY_METER_HOURS; ++idx)
+    sum += this->getHour(idx);
+  return sum;
+}
+
+void EnergyMeter::m_advance(uint32_t time) {
+  this->m_hourPhase += time - this->m_time;
+  this->m_time = time;
+  while (this->m_hourPhase >= HOUR_MS) {
+    this->m_hourPhase -= HOUR_MS;
+    this->m_nextHour();
+  }
+}
+
+void EnergyMeter::m_nextHour() {
+  this->m_hour = (this->m_hour + 1) % MIDEA_ENERGY_METER_HOURS;
+  this->m_hours[this->m_hour] = 0;
+  if (++this->m_hourOfDay < 24)
+    return;
+  this->m_hourOfDay = 0;
+  this->m_day = (this->m_day + 1) % MIDEA_ENERGY_METER_DAYS;
+  this->m_days[this->m_day] = 0;
+}
+
+}  // namespace dudanov
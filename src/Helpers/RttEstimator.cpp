@@ -0,0 +1,46 @@
+#include "Helpers/RttEstimator.h"
+
+namespace dudanov {
+
+void RttEstimator::addSample(uint32_t rtt) {
+  // zero RTT is below clock granularity
+  if (rtt == 0)
+    rtt = 1;
+  if (!this->m_srtt) {
+    this->m_srtt = rtt << 3;
+    this->m_rttvar = rtt << 1;
+  } else {
+    // RTTVAR = 3/4 * RTTVAR + 1/4 * |SRTT - R|
+    const uint32_t srtt = this->m_srtt >> 3;
+    const uint32_t err = srtt > rtt ? srtt - rtt : rtt - srtt;
+    this->m_rttvar += err - (this->m_rttvar >> 2);
+    // SRTT = 7/8 * SRTT + 1/8 * R
+    this->m_srtt += rtt - (this->m_srtt >> 3);
+  }
+  this->m_update();
+}
+
+void RttEstimator::backoff() {
+  this->m_rto = (this->m_rto > this->m_max / 2) ? this->m_max : this->m_rto * 2;
+}
+
+void RttEstimator::setLimits(uint32_t minTimeout, uint32_t maxTimeout) {
+  this->m_min = minTimeout;
+  this->m_max = maxTimeout;
+  if (this->m_srtt)
+    this->m_update();
+  else
+    this->m_rto = maxTimeout;
+}
+
+void RttEstimator::m_update() {
+  // RTO = SRTT + max(G, 4 * RTTVAR)
+  uint32_t rto = (this->m_srtt >> 3) + (this->m_rttvar ? this->m_rttvar : 1);
+  if (rto < this->m_min)
+    rto = this->m_min;
+  if (rto > this->m_max)
+    rto = this->m_max;
+  this->m_rto = rto;
+}
+
+}  // namespace dudanov
@@ -1,18 +1,49 @@
 #include <Arduino.h>
 #include "Helpers/Timer.h"
+#include <algorithm>
 
 namespace dudanov {
 
+const TimerTick TimerManager::NO_DEADLINE;
 TimerTick TimerManager::s_millis;
 
+TimerManager::TimerManager() : m_clock(&ArduinoClock::instance()) {}
+
+TimerTick TimerManager::setClock(Clock *clock) {
+  if (clock == nullptr)
+    clock = &ArduinoClock::instance();
+  // running timers keep their remaining time on new time base
+  const TimerTick delta = clock->now() - this->m_clock->now();
+  for (auto timer : this->m_timers)
+    timer->m_last += delta;
+  this->m_clock = clock;
+  this->m_millis = clock->now();
+  return delta;
+}
+
+void TimerManager::registerTimer(Timer &timer) {
+  timer.m_manager = this;
+  this->m_timers.push_back(&timer);
+}
+
+TimerTick TimerManager::getNextDelay(TimerTick now) const {
+  TimerTick delay = NO_DEADLINE;
+  for (auto timer : this->m_timers)
+    if (timer->isEnabled())
+      delay = std::min(delay, timer->getRemaining(now));
+  return delay;
+}
+
 // Dummy function for incorrect using case.
 static void dummy(Timer *timer) { timer->stop(); }
 Timer::Timer() : m_callback(dummy), m_alarm(0) {}
 
 /// Timers task. Must be periodically called in loop function.
 void TimerManager::task() {
-  s_millis = ::millis();
-  for (auto timer : m_timers)
+  this->m_millis = this->m_clock->now();
+  if (this->m_clock == &ArduinoClock::instance())
+    s_millis = this->m_millis;
+  for (auto timer : this->m_timers)
     if (timer->isEnabled() && timer->isExpired())
       timer->call();
 }
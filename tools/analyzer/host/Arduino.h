@@ -0,0 +1,61 @@
+#pragma once
+// Minimal host replacement of the Arduino core, just enough to build the frame decoders on Linux.
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+
+class __FlashStringHelper;
+#define F(str) (reinterpret_cast<const __FlashStringHelper *>(str))
+
+unsigned long millis();
+long random(long max);
+
+class String {
+ public:
+  String() = default;
+  String(const char *str) : m_str(str) {}
+  void reserve(size_t size) { this->m_str.reserve(size); }
+  String &operator+=(const char *str) {
+    this->m_str += str;
+    return *this;
+  }
+  String &operator+=(char c) {
+    this->m_str += c;
+    return *this;
+  }
+  const char *c_str() const { return this->m_str.c_str(); }
+  size_t length() const { return this->m_str.size(); }
+
+ private:
+  std::string m_str;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t data) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size) {
+    size_t n = 0;
+    while (size--)
+      n += this->write(*buf++);
+    return n;
+  }
+  virtual int availableForWrite() { return 0; }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  size_t readBytes(uint8_t *buf, size_t size) {
+    size_t n = 0;
+    for (int c; n < size && (c = this->read()) >= 0; ++n)
+      buf[n] = c;
+    return n;
+  }
+};
@@ -0,0 +1,10 @@
+#pragma once
+#include <Arduino.h>
+
+class IPAddress {
+ public:
+  uint8_t operator[](int idx) const { return this->m_octets[idx]; }
+
+ private:
+  uint8_t m_octets[4]{};
+};
@@ -0,0 +1,545 @@
+// Offline analyzer of MideaUART traces and debug logs.
+//
+// Reads binary traces written by `StreamTraceSink` and text logs with `RX: AA ...` / `TX: AA ...`
+// lines, validates frame checksums and data CRCs, decodes them with the library's own decoders
+// and prints state transitions as CSV or TSV. Inputs are memory-mapped; text logs are split into
+// line-aligned chunks and decoded in parallel, then transitions are extracted per file in order.
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "Appliance/AirConditioner/Capabilities.h"
+#include "Appliance/AirConditioner/StatusData.h"
+#include "Frame/Frame.h"
+#include "Frame/FrameTrace.h"
+
+using namespace dudanov::midea;
+using namespace dudanov::midea::ac;
+
+/* Host glue for the library sources */
+
+static bool s_logEnabled = false;
+
+unsigned long millis() { return 0; }
+long random(long max) { return std::rand() % max; }
+
+namespace dudanov {
+
+static void s_vlog(const char *tag, const char *format, va_list args) {
+  if (!s_logEnabled)
+    return;
+  std::fprintf(stderr, "[%s] ", tag);
+  std::vfprintf(stderr, format, args);
+  std::fputc('\n', stderr);
+}
+
+void sv_log_printf_(int, const char *tag, int, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  s_vlog(tag, format, args);
+  va_end(args);
+}
+
+void sv_log_printf_(int, const char *tag, int, const __FlashStringHelper *format, ...) {
+  va_list args;
+  va_start(args, format);
+  s_vlog(tag, reinterpret_cast<const char *>(format), args);
+  va_end(args);
+}
+
+}  // namespace dudanov
+
+namespace {
+
+/* Decoding */
+
+/// Frame built from captured raw bytes
+class RawFrame : public Frame {
+ public:
+  RawFrame(const uint8_t *data, uint8_t size) { this->m_data.assign(data, data + size); }
+  /// Start byte and length field are consistent with captured size
+  bool hasValidLength() const {
+    return this->m_data.size() > OFFSET_DATA && this->m_data[OFFSET_START] == START_BYTE &&
+           this->m_len() + 1U == this->m_data.size();
+  }
+};
+
+enum EventKind : uint8_t {
+  EVENT_STATUS,
+  EVENT_POWER,
+  EVENT_CAPABILITIES,
+};
+
+/// Decoded frame. `pos` is the line number inside chunk for text logs or timestamp for traces.
+struct Event {
+  uint64_t pos;
+  EventKind kind;
+  Mode mode;
+  Preset preset;
+  FanMode fanMode;
+  SwingMode swingMode;
+  float targetTemp;
+  float indoorTemp;
+  float outdoorTemp;
+  float humidity;
+  float power;
+  // Offset of capabilities page in `Chunk::pages`
+  uint32_t page;
+};
+
+struct Counters {
+  uint64_t lines;
+  uint64_t rx;
+  uint64_t tx;
+  uint64_t badLength;
+  uint64_t badChecksum;
+  uint64_t badCRC;
+  uint64_t truncated;
+  void add(const Counters &other) {
+    this->lines += other.lines;
+    this->rx += other.rx;
+    this->tx += other.tx;
+    this->badLength += other.badLength;
+    this->badChecksum += other.badChecksum;
+    this->badCRC += other.badCRC;
+    this->truncated += other.truncated;
+  }
+};
+
+struct Input {
+  const char *path;
+  const uint8_t *data;
+  size_t size;
+  bool isBinary;
+};
+
+/// Unit of parallel work: a whole trace or a line-aligned part of text log
+struct Chunk {
+  size_t input;
+  const uint8_t *begin;
+  const uint8_t *end;
+  std::vector<Event> events;
+  // Capabilities pages: size byte followed by data
+  std::vector<uint8_t> pages;
+  Counters counters;
+};
+
+void decodeFrame(Chunk &chunk, uint64_t pos, bool isRX, const uint8_t *data, uint8_t size) {
+  ++(isRX ? chunk.counters.rx : chunk.counters.tx);
+  const RawFrame frame(data, size);
+  if (!frame.hasValidLength()) {
+    ++chunk.counters.badLength;
+    return;
+  }
+  if (!frame.isValid()) {
+    ++chunk.counters.badChecksum;
+    return;
+  }
+  const FrameData fd = frame.getData();
+  if (!fd.hasValidCRC()) {
+    ++chunk.counters.badCRC;
+    return;
+  }
+  if (!isRX)
+    return;
+  Event ev{};
+  ev.pos = pos;
+  if (fd.hasStatus()) {
+    const StatusData status = FrameData(fd).to<StatusData>();
+    ev.kind = EVENT_STATUS;
+    ev.mode = status.getMode();
+    ev.preset = status.getPreset();
+    ev.fanMode = status.getFanMode();
+    ev.swingMode = status.getSwingMode();
+    ev.targetTemp = status.getTargetTemp();
+    ev.indoorTemp = status.getIndoorTemp();
+    ev.outdoorTemp = status.getOutdoorTemp();
+    ev.humidity = status.getHumiditySetpoint();
+  } else if (fd.hasPowerInfo() && fd.size() > 19) {
+    ev.kind = EVENT_POWER;
+    ev.power = FrameData(fd).to<StatusData>().getPowerUsage();
+  } else if (fd.hasID(0xB5)) {
+    ev.kind = EVENT_CAPABILITIES;
+    ev.page = chunk.pages.size();
+    chunk.pages.push_back(fd.size());
+    chunk.pages.insert(chunk.pages.end(), fd.data(), fd.data() + fd.size());
+  } else {
+    return;
+  }
+  chunk.events.push_back(ev);
+}
+
+int hexDigit(uint8_t c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c |= 0x20;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+void parseLine(Chunk &chunk, uint64_t line, const uint8_t *it, const uint8_t *end) {
+  // Looking for "RX: " or "TX: " marker
+  for (; end - it >= 4; ++it) {
+    if (it[1] != 'X' || it[2] != ':' || it[3] != ' ' || (it[0] != 'R' && it[0] != 'T'))
+      continue;
+    const bool isRX = it[0] == 'R';
+    uint8_t buf[256];
+    unsigned size = 0;
+    for (it += 4; it < end && size < sizeof(buf); ++it) {
+      if (*it == ' ')
+        continue;
+      int hi, lo;
+      if (end - it < 2 || (hi = hexDigit(it[0])) < 0 || (lo = hexDigit(it[1])) < 0)
+        break;
+      buf[size++] = hi << 4 | lo;
+      ++it;
+    }
+    if (size && buf[0] == 0xAA && size <= 255)
+      decodeFrame(chunk, line, isRX, buf, size);
+    return;
+  }
+}
+
+void parseText(Chunk &chunk) {
+  uint64_t line = 0;
+  for (const uint8_t *it = chunk.begin; it < chunk.end;) {
+    auto eol = static_cast<const uint8_t *>(std::memchr(it, '\n', chunk.end - it));
+    if (eol == nullptr)
+      eol = chunk.end;
+    parseLine(chunk, ++line, it, eol);
+    it = eol + 1;
+  }
+  chunk.counters.lines = line;
+}
+
+void parseTrace(Chunk &chunk) {
+  TraceRecord record;
+  const uint8_t *it = chunk.begin;
+  for (; chunk.end - it >= TraceRecord::HEADER_SIZE; it += record.size) {
+    if (!record.decode(it))
+      break;
+    it += TraceRecord::HEADER_SIZE;
+    if (chunk.end - it < record.size)
+      break;
+    ++chunk.counters.lines;
+    decodeFrame(chunk, record.timestamp, record.direction == TRACE_RX, it, record.size);
+  }
+  if (it != chunk.end)
+    ++chunk.counters.truncated;
+}
+
+bool isBinary(const uint8_t *data, size_t size) {
+  size = std::min<size_t>(size, 4096);
+  for (size_t n = 0; n < size; ++n)
+    if (data[n] < 0x09 || (data[n] > 0x0D && data[n] < 0x20))
+      return true;
+  return false;
+}
+
+/* Output */
+
+const char *modeName(Mode mode) {
+  static const char *const NAMES[] = {"off", "auto", "cool", "dry", "heat", "fan_only"};
+  return mode < 6 ? NAMES[mode] : "?";
+}
+
+const char *presetName(Preset preset) {
+  static const char *const NAMES[] = {"none", "sleep", "turbo", "eco", "freeze_protection"};
+  return preset < 5 ? NAMES[preset] : "?";
+}
+
+const char *fanName(FanMode fan) {
+  switch (fan) {
+    case FAN_AUTO: return "auto";
+    case FAN_SILENT: return "silent";
+    case FAN_LOW: return "low";
+    case FAN_MEDIUM: return "medium";
+    case FAN_HIGH: return "high";
+    case FAN_TURBO: return "turbo";
+    default: return "?";
+  }
+}
+
+const char *swingName(SwingMode swing) {
+  switch (swing) {
+    case SWING_OFF: return "off";
+    case SWING_BOTH: return "both";
+    case SWING_VERTICAL: return "vertical";
+    case SWING_HORIZONTAL: return "horizontal";
+    default: return "?";
+  }
+}
+
+struct Options {
+  char delimiter{','};
+  bool header{true};
+  bool allRows{false};
+  bool verbose{false};
+  unsigned threads{0};
+  size_t chunkSize{8 << 20};
+};
+
+/// Decoded state of one input, updated by events in order
+struct State {
+  bool hasStatus;
+  bool hasPower;
+  Event status;
+  float power;
+  bool operator==(const State &other) const {
+    return this->hasStatus == other.hasStatus && this->hasPower == other.hasPower &&
+           this->power == other.power && this->status.mode == other.status.mode &&
+           this->status.preset == other.status.preset && this->status.fanMode == other.status.fanMode &&
+           this->status.swingMode == other.status.swingMode &&
+           this->status.targetTemp == other.status.targetTemp &&
+           this->status.indoorTemp == other.status.indoorTemp &&
+           this->status.outdoorTemp == other.status.outdoorTemp &&
+           this->status.humidity == other.status.humidity;
+  }
+};
+
+class Writer {
+ public:
+  explicit Writer(const Options &options) : m_options(options) {}
+  ~Writer() { this->flush(); }
+  void header() {
+    static const char *const COLUMNS[] = {"file", "pos", "mode", "preset", "fan", "swing",
+                                          "target", "indoor", "outdoor", "humidity", "power"};
+    for (const char *column : COLUMNS)
+      this->m_field("%s", column);
+    this->m_endRow();
+  }
+  void row(const char *file, uint64_t pos, const State &state) {
+    this->m_field("%s", file);
+    this->m_field("%llu", static_cast<unsigned long long>(pos));
+    if (state.hasStatus) {
+      const Event &s = state.status;
+      this->m_field("%s", modeName(s.mode));
+      this->m_field("%s", presetName(s.preset));
+      this->m_field("%s", fanName(s.fanMode));
+      this->m_field("%s", swingName(s.swingMode));
+      this->m_field("%.1f", s.targetTemp);
+      this->m_field("%.1f", s.indoorTemp);
+      this->m_field("%.1f", s.outdoorTemp);
+      this->m_field("%.0f", s.humidity);
+    } else {
+      for (int n = 0; n < 8; ++n)
+        this->m_field("%s", "");
+    }
+    if (state.hasPower)
+      this->m_field("%.1f", state.power);
+    else
+      this->m_field("%s", "");
+    this->m_endRow();
+  }
+  void flush() {
+    std::fwrite(this->m_buf, 1, this->m_size, stdout);
+    this->m_size = 0;
+  }
+
+ private:
+  void m_field(const char *format, ...) {
+    if (this->m_isFirst)
+      this->m_isFirst = false;
+    else
+      this->m_buf[this->m_size++] = this->m_options.delimiter;
+    va_list args;
+    va_start(args, format);
+    const int n = std::vsnprintf(this->m_buf + this->m_size, sizeof(this->m_buf) - this->m_size, format, args);
+    va_end(args);
+    this->m_size += std::min<size_t>(n, sizeof(this->m_buf) - this->m_size - 1);
+  }
+  void m_endRow() {
+    this->m_buf[this->m_size++] = '\n';
+    this->m_isFirst = true;
+    if (this->m_size > sizeof(this->m_buf) - 1024)
+      this->flush();
+  }
+  const Options &m_options;
+  char m_buf[1 << 16];
+  size_t m_size{0};
+  bool m_isFirst{true};
+};
+
+/// Sequential pass over decoded chunks of one input
+void report(Writer &writer, const Options &options, const Input &input, const std::vector<Chunk> &chunks,
+            size_t first, size_t last) {
+  Counters counters{};
+  State state{}, lastState{};
+  Capabilities caps;
+  bool hasCaps = false, isCapsComplete = true;
+  uint64_t transitions = 0, lineBase = 0;
+  for (size_t n = first; n < last; ++n) {
+    const Chunk &chunk = chunks[n];
+    for (const Event &ev : chunk.events) {
+      switch (ev.kind) {
+        case EVENT_STATUS:
+          state.hasStatus = true;
+          state.status = ev;
+          break;
+        case EVENT_POWER:
+          state.hasPower = true;
+          state.power = ev.power;
+          break;
+        case EVENT_CAPABILITIES:
+          if (isCapsComplete)
+            caps.begin();
+          isCapsComplete = !caps.read(FrameData(&chunk.pages[ev.page + 1], chunk.pages[ev.page]));
+          hasCaps = true;
+          continue;
+      }
+      if (!options.allRows && state == lastState)
+        continue;
+      lastState = state;
+      ++transitions;
+      writer.row(input.path, input.isBinary ? ev.pos : lineBase + ev.pos, state);
+    }
+    lineBase += chunk.counters.lines;
+    counters.add(chunk.counters);
+  }
+  std::fprintf(stderr,
+               "%s: %s, %llu %s, %llu RX, %llu TX, bad length %llu, bad checksum %llu, bad CRC %llu, "
+               "%llu rows%s\n",
+               input.path, input.isBinary ? "trace" : "log", static_cast<unsigned long long>(counters.lines),
+               input.isBinary ? "records" : "lines", static_cast<unsigned long long>(counters.rx),
+               static_cast<unsigned long long>(counters.tx), static_cast<unsigned long long>(counters.badLength),
+               static_cast<unsigned long long>(counters.badChecksum),
+               static_cast<unsigned long long>(counters.badCRC), static_cast<unsigned long long>(transitions),
+               counters.truncated ? ", truncated" : "");
+  if (hasCaps && options.verbose) {
+    writer.flush();
+    s_logEnabled = true;
+    caps.dump();
+    s_logEnabled = options.verbose;
+  }
+}
+
+void usage(const char *name) {
+  std::fprintf(stderr,
+               "Usage: %s [-f csv|tsv] [-a] [-H] [-j threads] [-v] FILE...\n"
+               "Decodes MideaUART binary traces and text logs into state transitions.\n"
+               "  -f FORMAT   output format: csv (default) or tsv\n"
+               "  -a          print a row for every decoded status frame, not only for changes\n"
+               "  -H          do not print the header row\n"
+               "  -j THREADS  number of worker threads (default: number of cores)\n"
+               "  -v          dump capabilities reports and library debug messages to stderr\n",
+               name);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:aHj:vh")) != -1) {
+    switch (opt) {
+      case 'f':
+        if (!std::strcmp(optarg, "csv")) {
+          options.delimiter = ',';
+        } else if (!std::strcmp(optarg, "tsv")) {
+          options.delimiter = '\t';
+        } else {
+          usage(argv[0]);
+          return 2;
+        }
+        break;
+      case 'a': options.allRows = true; break;
+      case 'H': options.header = false; break;
+      case 'j': options.threads = std::strtoul(optarg, nullptr, 10); break;
+      case 'v': options.verbose = true; break;
+      default: usage(argv[0]); return opt == 'h' ? 0 : 2;
+    }
+  }
+  if (optind == argc) {
+    usage(argv[0]);
+    return 2;
+  }
+  s_logEnabled = options.verbose;
+
+  // Map inputs and split them into chunks
+  std::vector<Input> inputs;
+  std::vector<Chunk> chunks;
+  int result = 0;
+  for (int n = optind; n < argc; ++n) {
+    const int fd = open(argv[n], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+      std::perror(argv[n]);
+      result = 1;
+      if (fd >= 0)
+        close(fd);
+      continue;
+    }
+    Input input{argv[n], nullptr, static_cast<size_t>(st.st_size), false};
+    if (input.size) {
+      void *map = mmap(nullptr, input.size, PROT_READ, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if (map == MAP_FAILED) {
+        std::perror(argv[n]);
+        result = 1;
+        continue;
+      }
+      madvise(map, input.size, MADV_SEQUENTIAL);
+      input.data = static_cast<const uint8_t *>(map);
+      input.isBinary = isBinary(input.data, input.size);
+    } else {
+      close(fd);
+    }
+    const uint8_t *it = input.data, *end = input.data + input.size;
+    do {
+      const uint8_t *next = end;
+      if (!input.isBinary && static_cast<size_t>(end - it) > options.chunkSize) {
+        next = static_cast<const uint8_t *>(std::memchr(it + options.chunkSize, '\n', end - it - options.chunkSize));
+        next = next != nullptr ? next + 1 : end;
+      }
+      Chunk chunk;
+      chunk.input = inputs.size();
+      chunk.begin = it;
+      chunk.end = next;
+      chunk.counters = Counters{};
+      chunks.push_back(std::move(chunk));
+      it = next;
+    } while (it != end);
+    inputs.push_back(input);
+  }
+
+  // Decode chunks in parallel
+  unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+  threads = std::max(1U, std::min<unsigned>(threads, chunks.size()));
+  std::atomic<size_t> nextChunk{0};
+  auto worker = [&]() {
+    for (size_t n; (n = nextChunk.fetch_add(1)) < chunks.size();) {
+      Chunk &chunk = chunks[n];
+      if (inputs[chunk.input].isBinary)
+        parseTrace(chunk);
+      else
+        parseText(chunk);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned n = 1; n < threads; ++n)
+    pool.emplace_back(worker);
+  worker();
+  for (std::thread &thread : pool)
+    thread.join();
+
+  // Extract transitions per input in order
+  Writer writer(options);
+  if (options.header)
+    writer.header();
+  for (size_t first = 0, last; first < chunks.size(); first = last) {
+    for (last = first + 1; last < chunks.size() && chunks[last].input == chunks[first].input;)
+      ++last;
+    report(writer, options, inputs[chunks[first].input], chunks, first, last);
+  }
+  writer.flush();
+  for (const Input &input : inputs)
+    if (input.size)
+      munmap(const_cast<uint8_t *>(input.data), input.size);
+  return result;
+}